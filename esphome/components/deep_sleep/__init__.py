@@ -1,8 +1,11 @@
 import esphome.codegen as cg
-from esphome.components import time
+from esphome.components import sensor, time
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome import pins, automation
 from esphome.const import (
+    CONF_ENABLE_ON_BOOT,
+    CONF_FROM,
     CONF_HOUR,
     CONF_ID,
     CONF_MINUTE,
@@ -11,9 +14,14 @@ from esphome.const import (
     CONF_PIN,
     CONF_PINS,
     CONF_RUN_DURATION,
+    CONF_SENSOR,
+    CONF_SENSORS,
+    CONF_THRESHOLD,
+    CONF_TRIGGER_ID,
     CONF_SECOND,
     CONF_SLEEP_DURATION,
     CONF_TIME_ID,
+    CONF_TO,
     CONF_WAKEUP_PIN,
     PLATFORM_ESP32,
     PLATFORM_ESP8266,
@@ -108,7 +116,7 @@ WAKEUP_PINS = {
 
 
 def validate_pin_number(value):
-    if CORE.is_libretiny:
+    if CORE.is_libretiny or CORE.is_host:
         return value
     valid_pins = WAKEUP_PINS.get(get_esp32_variant(), WAKEUP_PINS[VARIANT_ESP32])
     if value[CONF_NUMBER] not in valid_pins:
@@ -158,6 +166,11 @@ EXT1_WAKEUP_MODES = {
     "ANY_HIGH": esp_sleep_ext1_wakeup_mode_t.ESP_EXT1_WAKEUP_ANY_HIGH,
 }
 WakeupCauseToRunDuration = deep_sleep_ns.struct("WakeupCauseToRunDuration")
+AdaptiveSleepConfig = deep_sleep_ns.struct("AdaptiveSleepConfig")
+JournalFlushTrigger = deep_sleep_ns.class_(
+    "JournalFlushTrigger",
+    automation.Trigger.template(cg.float_, cg.uint32, cg.uint8),
+)
 
 CONF_WAKEUP_PIN_MODE = "wakeup_pin_mode"
 CONF_ESP32_EXT1_WAKEUP = "esp32_ext1_wakeup"
@@ -166,7 +179,39 @@ CONF_DEFAULT = "default"
 CONF_GPIO_WAKEUP_REASON = "gpio_wakeup_reason"
 CONF_TOUCH_WAKEUP_REASON = "touch_wakeup_reason"
 CONF_UNTIL = "until"
+CONF_SCHEDULE = "schedule"
+CONF_HOLDER = "holder"
+CONF_MAX_HOLD = "max_hold"
+CONF_SCHEDULE_ID = "schedule_id"
+CONF_EVERY = "every"
 CONF_WAKEUP_PINS = "wakeup_pins"
+CONF_SLEEP_WHEN_PUBLISHED = "sleep_when_published"
+CONF_GRACE_DELAY = "grace_delay"
+CONF_JOURNAL = "journal"
+CONF_FLUSH_EVERY = "flush_every"
+CONF_ON_FLUSH = "on_flush"
+CONF_ADAPTIVE_SLEEP = "adaptive_sleep"
+CONF_CLOCK = "clock"
+CONF_SHUTDOWN = "shutdown"
+CONF_DEADLINE = "deadline"
+CONF_CRITICAL = "critical"
+CONF_ALIGN_TO = "align_to"
+CONF_DRIFT_CORRECTION = "drift_correction"
+CONF_MIN_SLEEP = "min_sleep"
+CONF_MAX_SLEEP = "max_sleep"
+CONF_FAST_CHANGE = "fast_change"
+CONF_ALARM_THRESHOLD = "alarm_threshold"
+CONF_ALARM_MARGIN = "alarm_margin"
+CONF_BATTERY = "battery"
+CONF_EMPTY_VOLTAGE = "empty_voltage"
+CONF_FULL_VOLTAGE = "full_voltage"
+CONF_CAPACITY = "capacity"
+CONF_LIFETIME = "lifetime"
+CONF_AWAKE_CURRENT = "awake_current"
+CONF_SLEEP_CURRENT = "sleep_current"
+
+# Must match SAMPLE_JOURNAL_CAPACITY in deep_sleep_component.h
+SAMPLE_JOURNAL_CAPACITY = 32
 
 WAKEUP_CAUSES_SCHEMA = cv.Schema(
     {
@@ -176,6 +221,95 @@ WAKEUP_CAUSES_SCHEMA = cv.Schema(
     }
 )
 
+SLEEP_WHEN_PUBLISHED_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_SENSORS): cv.All(
+            cv.ensure_list(cv.use_id(sensor.Sensor)), cv.Length(min=1, max=32)
+        ),
+        cv.Optional(
+            CONF_GRACE_DELAY, default="500ms"
+        ): cv.positive_time_period_milliseconds,
+    }
+)
+
+# Journal one sample per wake in RTC memory; bring the radio up only every
+# flush_every wakes or when the value moved by at least threshold.
+# Requires `wifi: enable_on_boot: false`, see _final_validate.
+JOURNAL_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_SENSOR): cv.use_id(sensor.Sensor),
+        cv.Optional(CONF_FLUSH_EVERY, default=10): cv.int_range(
+            min=1, max=SAMPLE_JOURNAL_CAPACITY
+        ),
+        cv.Optional(CONF_THRESHOLD): cv.positive_float,
+        cv.Optional(CONF_ON_FLUSH): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(JournalFlushTrigger),
+            }
+        ),
+    }
+)
+
+
+def validate_adaptive_sleep(config):
+    if config[CONF_MIN_SLEEP] > config[CONF_MAX_SLEEP]:
+        raise cv.Invalid("min_sleep must not be greater than max_sleep")
+    battery = config.get(CONF_BATTERY, {})
+    if battery and battery[CONF_EMPTY_VOLTAGE] >= battery[CONF_FULL_VOLTAGE]:
+        raise cv.Invalid("empty_voltage must be lower than full_voltage")
+    return config
+
+
+# The battery block sets an energy floor: the shortest sleep that still lasts
+# `lifetime` at the current charge given the awake and sleep currents.
+ADAPTIVE_SLEEP_BATTERY_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_SENSOR): cv.use_id(sensor.Sensor),
+        cv.Optional(CONF_EMPTY_VOLTAGE, default=3.3): cv.float_,
+        cv.Optional(CONF_FULL_VOLTAGE, default=4.2): cv.float_,
+        cv.Required(CONF_CAPACITY): cv.positive_float,  # mAh
+        cv.Required(CONF_LIFETIME): cv.positive_time_period_seconds,
+        cv.Required(CONF_AWAKE_CURRENT): cv.positive_float,  # mA
+        cv.Optional(CONF_SLEEP_CURRENT, default=0.01): cv.positive_float,  # mA
+    }
+)
+
+ADAPTIVE_SLEEP_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Required(CONF_SENSOR): cv.use_id(sensor.Sensor),
+            cv.Required(CONF_MIN_SLEEP): cv.positive_time_period_milliseconds,
+            cv.Required(CONF_MAX_SLEEP): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_FAST_CHANGE, default=0): cv.positive_float,
+            cv.Inclusive(CONF_ALARM_THRESHOLD, "alarm"): cv.float_,
+            cv.Inclusive(CONF_ALARM_MARGIN, "alarm"): cv.positive_float,
+            cv.Optional(CONF_BATTERY): ADAPTIVE_SLEEP_BATTERY_SCHEMA,
+        }
+    ),
+    validate_adaptive_sleep,
+)
+
+# Timer sleeps end on wall-clock boundaries and are scaled by the measured slow clock error
+CLOCK_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+        cv.Optional(CONF_ALIGN_TO): cv.All(
+            cv.positive_time_period_seconds,
+            cv.Range(min=cv.TimePeriod(seconds=1), max=cv.TimePeriod(days=7)),
+        ),
+        cv.Optional(CONF_DRIFT_CORRECTION, default=True): cv.boolean,
+    }
+)
+
+# Shutdown hooks are run per component; once the deadline (counted from the decision to sleep) has passed
+# only the critical components still start shutting down
+SHUTDOWN_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_DEADLINE): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_CRITICAL, default=[]): cv.ensure_list(cv.use_id(cg.Component)),
+    }
+)
+
 WakeUpPinItem = deep_sleep_ns.struct("WakeUpPinItem")
 WAKEUP_PINS_SCHEMA = cv.ensure_list(
     cv.Schema(
@@ -192,17 +326,19 @@ CONFIG_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(DeepSleepComponent),
         cv.Optional(CONF_RUN_DURATION): cv.Any(
-            cv.All(cv.only_on_esp32, WAKEUP_CAUSES_SCHEMA),
+            cv.All(cv.only_on(["esp32", "host"]), WAKEUP_CAUSES_SCHEMA),
             cv.positive_time_period_milliseconds,
         ),
         cv.Optional(CONF_SLEEP_DURATION): cv.positive_time_period_milliseconds,
         cv.Optional(CONF_WAKEUP_PIN): cv.All(
-            cv.only_on(["esp32", "libretiny", "bk72xx"]),
+            cv.only_on(["esp32", "libretiny", "bk72xx", "host"]),
             pins.internal_gpio_input_pin_schema,
             validate_pin_number,
         ),
         cv.Optional(CONF_WAKEUP_PIN_MODE): cv.All(
-            cv.only_on(["esp32", "libretiny", "bk72xx"]), cv.enum(WAKEUP_PIN_MODES), upper=True
+            cv.only_on(["esp32", "libretiny", "bk72xx", "host"]),
+            cv.enum(WAKEUP_PIN_MODES),
+            upper=True,
         ),
         cv.Optional(CONF_ESP32_EXT1_WAKEUP): cv.All(
             cv.only_on_esp32,
@@ -220,10 +356,32 @@ CONFIG_SCHEMA = cv.Schema(
             WAKEUP_PINS_SCHEMA,
         ),
         cv.Optional(CONF_TOUCH_WAKEUP): cv.All(cv.only_on_esp32, cv.boolean),
+        cv.Optional(CONF_SLEEP_WHEN_PUBLISHED): SLEEP_WHEN_PUBLISHED_SCHEMA,
+        cv.Optional(CONF_JOURNAL): cv.All(cv.only_on(["esp32", "host"]), JOURNAL_SCHEMA),
+        cv.Optional(CONF_ADAPTIVE_SLEEP): ADAPTIVE_SLEEP_SCHEMA,
+        cv.Optional(CONF_CLOCK): CLOCK_SCHEMA,
+        cv.Optional(CONF_SHUTDOWN): SHUTDOWN_SCHEMA,
     }
 ).extend(cv.COMPONENT_SCHEMA)
 
 
+def _final_validate(config):
+    # With wifi coming up on boot the radio runs on every wake and the journal saves nothing
+    wifi_config = fv.full_config.get().get("wifi")
+    if (
+        CONF_JOURNAL in config
+        and wifi_config is not None
+        and wifi_config.get(CONF_ENABLE_ON_BOOT, True)
+    ):
+        raise cv.Invalid(
+            f"{CONF_JOURNAL} requires 'enable_on_boot: false' in the wifi configuration",
+            path=[CONF_JOURNAL],
+        )
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
@@ -291,6 +449,69 @@ async def to_code(config):
                 )
             )
 
+    if CONF_SLEEP_WHEN_PUBLISHED in config:
+        conf = config[CONF_SLEEP_WHEN_PUBLISHED]
+        for sensor_id in conf[CONF_SENSORS]:
+            sens = await cg.get_variable(sensor_id)
+            cg.add(var.add_required_sensor(sens))
+        cg.add(var.set_publish_grace_delay(conf[CONF_GRACE_DELAY]))
+
+    if CONF_ADAPTIVE_SLEEP in config:
+        conf = config[CONF_ADAPTIVE_SLEEP]
+        battery = conf.get(CONF_BATTERY, {})
+        lifetime = battery.get(CONF_LIFETIME)
+        adaptive_config = cg.StructInitializer(
+            AdaptiveSleepConfig,
+            ("min_sleep_ms", conf[CONF_MIN_SLEEP]),
+            ("max_sleep_ms", conf[CONF_MAX_SLEEP]),
+            ("fast_change", conf[CONF_FAST_CHANGE]),
+            ("alarm_threshold", conf.get(CONF_ALARM_THRESHOLD, cg.RawExpression("NAN"))),
+            ("alarm_margin", conf.get(CONF_ALARM_MARGIN, 0)),
+            ("battery_empty", battery.get(CONF_EMPTY_VOLTAGE, 0)),
+            ("battery_full", battery.get(CONF_FULL_VOLTAGE, 0)),
+            ("capacity_mah", battery.get(CONF_CAPACITY, 0)),
+            ("lifetime_hours", lifetime.total_seconds / 3600 if lifetime else 0),
+            ("awake_current_ma", battery.get(CONF_AWAKE_CURRENT, 0)),
+            ("sleep_current_ma", battery.get(CONF_SLEEP_CURRENT, 0)),
+        )
+        sens = await cg.get_variable(conf[CONF_SENSOR])
+        cg.add(var.set_adaptive_sleep(sens, adaptive_config))
+        if battery:
+            sens = await cg.get_variable(battery[CONF_SENSOR])
+            cg.add(var.set_battery_sensor(sens))
+
+    if CONF_JOURNAL in config:
+        conf = config[CONF_JOURNAL]
+        sens = await cg.get_variable(conf[CONF_SENSOR])
+        cg.add(var.set_journal(sens, conf[CONF_FLUSH_EVERY]))
+        if CONF_THRESHOLD in conf:
+            cg.add(var.set_journal_threshold(conf[CONF_THRESHOLD]))
+        for conf_trigger in conf.get(CONF_ON_FLUSH, []):
+            trigger = cg.new_Pvariable(conf_trigger[CONF_TRIGGER_ID])
+            cg.add(var.add_journal_flush_trigger(trigger))
+            await automation.build_automation(
+                trigger,
+                [(cg.float_, "x"), (cg.uint32, "age"), (cg.uint8, "wake_cause")],
+                conf_trigger,
+            )
+
+    if CONF_CLOCK in config:
+        conf = config[CONF_CLOCK]
+        time_ = await cg.get_variable(conf[CONF_TIME_ID])
+        cg.add(var.set_time(time_))
+        if CONF_ALIGN_TO in conf:
+            cg.add(var.set_align_to(conf[CONF_ALIGN_TO].total_seconds))
+        cg.add(var.set_drift_correction(conf[CONF_DRIFT_CORRECTION]))
+
+    if CONF_SHUTDOWN in config:
+        conf = config[CONF_SHUTDOWN]
+        if CONF_DEADLINE in conf:
+            cg.add(var.set_shutdown_deadline(conf[CONF_DEADLINE]))
+        for id_ in conf[CONF_CRITICAL]:
+            critical = await cg.get_variable(id_)
+            cg.add(var.add_critical_shutdown_component(critical))
+        cg.add_define("USE_DEEP_SLEEP_SHUTDOWN_TIMING")
+
     cg.add_define("USE_DEEP_SLEEP")
 
 
@@ -300,6 +521,60 @@ DEEP_SLEEP_ACTION_SCHEMA = cv.Schema(
     }
 )
 
+SECONDS_PER_DAY = 24 * 60 * 60
+MAX_SCHEDULE_SLOTS = 2048
+
+
+def _seconds_of_day(value):
+    return value[CONF_HOUR] * 3600 + value[CONF_MINUTE] * 60 + value[CONF_SECOND]
+
+
+# A slot is either a single time of day or a range repeated `every` interval;
+# ranges with `to` before `from` wrap past midnight.
+SCHEDULE_RANGE_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_FROM): cv.time_of_day,
+        cv.Required(CONF_TO): cv.time_of_day,
+        cv.Required(CONF_EVERY): cv.All(
+            cv.positive_time_period_seconds, cv.Range(min=cv.TimePeriod(seconds=1))
+        ),
+    }
+)
+
+
+def expand_schedule(value):
+    slots = set()
+    for item in value:
+        if CONF_EVERY not in item:
+            slots.add(_seconds_of_day(item))
+            continue
+        start = _seconds_of_day(item[CONF_FROM])
+        end = _seconds_of_day(item[CONF_TO])
+        if end < start:
+            end += SECONDS_PER_DAY
+        slots.update(
+            t % SECONDS_PER_DAY
+            for t in range(start, end + 1, item[CONF_EVERY].total_seconds)
+        )
+    if len(slots) > MAX_SCHEDULE_SLOTS:
+        raise cv.Invalid(
+            f"Schedule expands to {len(slots)} wake slots, at most {MAX_SCHEDULE_SLOTS} are supported"
+        )
+    return sorted(slots)
+
+
+SCHEDULE_SCHEMA = cv.All(
+    cv.ensure_list(cv.Any(cv.time_of_day, SCHEDULE_RANGE_SCHEMA)),
+    cv.Length(min=1),
+    expand_schedule,
+)
+
+def validate_wake_time(config):
+    if (CONF_UNTIL in config or CONF_SCHEDULE in config) != (CONF_TIME_ID in config):
+        raise cv.Invalid("until/schedule and time_id must be used together")
+    return config
+
+
 DEEP_SLEEP_ENTER_SCHEMA = cv.All(
     automation.maybe_simple_id(
         DEEP_SLEEP_ACTION_SCHEMA.extend(
@@ -312,12 +587,16 @@ DEEP_SLEEP_ENTER_SCHEMA = cv.All(
                     cv.Exclusive(CONF_UNTIL, "time"): cv.All(
                         cv.only_on_esp32, cv.time_of_day
                     ),
+                    cv.Exclusive(CONF_SCHEDULE, "time"): cv.All(
+                        cv.only_on_esp32, SCHEDULE_SCHEMA
+                    ),
+                    cv.GenerateID(CONF_SCHEDULE_ID): cv.declare_id(cg.uint32),
                     cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
                 }
             )
         )
     ),
-    cv.has_none_or_all_keys(CONF_UNTIL, CONF_TIME_ID),
+    validate_wake_time,
 )
 
 
@@ -328,30 +607,61 @@ async def deep_sleep_enter_to_code(config, action_id, template_arg, args):
     paren = await cg.get_variable(config[CONF_ID])
     var = cg.new_Pvariable(action_id, template_arg, paren)
     if CONF_SLEEP_DURATION in config:
-        template_ = await cg.templatable(config[CONF_SLEEP_DURATION], args, cg.int32)
+        template_ = await cg.templatable(config[CONF_SLEEP_DURATION], args, cg.uint64)
         cg.add(var.set_sleep_duration(template_))
 
     if CONF_UNTIL in config:
         until = config[CONF_UNTIL]
         cg.add(var.set_until(until[CONF_HOUR], until[CONF_MINUTE], until[CONF_SECOND]))
 
+    if CONF_SCHEDULE in config:
+        # Sorted seconds of the day, looked up with a binary search on the device
+        slots = cg.static_const_array(config[CONF_SCHEDULE_ID], config[CONF_SCHEDULE])
+        cg.add(var.set_schedule(slots, len(config[CONF_SCHEDULE])))
+
+    if CONF_TIME_ID in config:
         time_ = await cg.get_variable(config[CONF_TIME_ID])
         cg.add(var.set_time(time_))
 
     return var
 
 
+# Named holders are reference counted; without a holder prevent/allow act as a single switch
+DEEP_SLEEP_PREVENT_SCHEMA = DEEP_SLEEP_ACTION_SCHEMA.extend(
+    {
+        cv.Optional(CONF_HOLDER): cv.string_strict,
+        cv.Optional(CONF_MAX_HOLD): cv.positive_time_period_milliseconds,
+    }
+)
+
+DEEP_SLEEP_ALLOW_SCHEMA = DEEP_SLEEP_ACTION_SCHEMA.extend(
+    {
+        cv.Optional(CONF_HOLDER): cv.string_strict,
+    }
+)
+
+
+def validate_max_hold(config):
+    if CONF_MAX_HOLD in config and CONF_HOLDER not in config:
+        raise cv.Invalid("max_hold requires a holder")
+    return config
+
+
 @automation.register_action(
     "deep_sleep.prevent",
     PreventDeepSleepAction,
-    automation.maybe_simple_id(DEEP_SLEEP_ACTION_SCHEMA),
+    cv.All(automation.maybe_simple_id(DEEP_SLEEP_PREVENT_SCHEMA), validate_max_hold),
 )
 @automation.register_action(
     "deep_sleep.allow",
     AllowDeepSleepAction,
-    automation.maybe_simple_id(DEEP_SLEEP_ACTION_SCHEMA),
+    automation.maybe_simple_id(DEEP_SLEEP_ALLOW_SCHEMA),
 )
 async def deep_sleep_action_to_code(config, action_id, template_arg, args):
     var = cg.new_Pvariable(action_id, template_arg)
     await cg.register_parented(var, config[CONF_ID])
+    if CONF_HOLDER in config:
+        cg.add(var.set_holder(config[CONF_HOLDER]))
+    if CONF_MAX_HOLD in config:
+        cg.add(var.set_max_hold(config[CONF_MAX_HOLD]))
     return var
@@ -6,6 +6,30 @@
 #ifdef USE_ESP8266
 #include <Esp.h>
 #endif
+#ifdef USE_HOST
+#include <chrono>
+#include <cstdlib>
+#include <sys/time.h>
+#include <thread>
+#endif
+
+#ifdef USE_API
+#include "esphome/components/api/api_server.h"
+#endif
+#ifdef USE_MQTT
+#include "esphome/components/mqtt/mqtt_client.h"
+#endif
+#if defined(USE_DEEP_SLEEP_JOURNAL) && defined(USE_WIFI)
+#include "esphome/components/wifi/wifi_component.h"
+#endif
+#ifdef USE_ESP32
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <sys/time.h>
+#endif
+#include <cmath>
+#include <cstddef>
+#include <cstring>
 
 namespace esphome {
 namespace deep_sleep {
@@ -14,16 +38,131 @@ static const char *const TAG = "deep_sleep";
 
 bool global_has_deep_sleep = false;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
 
-optional<uint32_t> DeepSleepComponent::get_run_duration_() const {
+#ifdef USE_HOST
+// Process memory stands in for RTC memory: it survives a simulated sleep, not a restart of the process
+#define RTC_NOINIT_ATTR
+
+void HostSleepHal::deep_sleep(const HostSleepRequest &request) {
+  // No deep sleep on the host: wait out the timer wakeup, then restart the process like a wake would
+  if (request.wakeup_pin != nullptr)
+    ESP_LOGW(TAG, "Host: wakeup pins cannot wake the process, only the timer");
+  if (!request.sleep_duration_us.has_value()) {
+    ESP_LOGI(TAG, "No wakeup source configured, exiting");
+    exit(0);
+  }
+  ESP_LOGD(TAG, "Host: timer wakeup after %" PRIu64 " us", *request.sleep_duration_us);
+  std::this_thread::sleep_for(std::chrono::microseconds(*request.sleep_duration_us));
+  arch_restart();
+}
+
+int64_t HostSleepHal::system_time_us() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<int64_t>(tv.tv_sec) * 1000000LL + tv.tv_usec;
+}
+
+static HostSleepHal default_host_sleep_hal;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+HostSleepHal *global_host_sleep_hal = &default_host_sleep_hal;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+#endif
+
+#ifdef USE_SENSOR
+static const uint32_t ADAPTIVE_SLEEP_MAGIC = 0x41534C50;  // "ASLP"
+static const uint32_t WAKE_METRICS_MAGIC = 0x574B4D54;    // "WKMT"
+static const float WAKE_METRICS_ALPHA = 0.2f;
+#if defined(USE_ESP32) || defined(USE_HOST)
+static RTC_NOINIT_ATTR AdaptiveSleepState adaptive_sleep_state;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+static RTC_NOINIT_ATTR WakeMetrics wake_metrics;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+#endif
+
+static float ewma(float average, float value, uint32_t samples) {
+  return samples <= 1 || std::isnan(average) ? value : average + WAKE_METRICS_ALPHA * (value - average);
+}
+
+static int64_t system_time_us() {
+#ifdef USE_ESP32
+  // The RTC keeps system time running through deep sleep
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<int64_t>(tv.tv_sec) * 1000000LL + tv.tv_usec;
+#elif defined(USE_HOST)
+  return global_host_sleep_hal->system_time_us();
+#else
+  return 0;
+#endif
+}
+#endif
+
+#if defined(USE_SENSOR) || defined(USE_TIME) || defined(USE_DEEP_SLEEP_SHUTDOWN_TIMING)
+static bool woke_from_deep_sleep() {
+#if defined(USE_ESP32)
+  return esp_reset_reason() == ESP_RST_DEEPSLEEP;
+#elif defined(USE_ESP8266)
+  return ESP.getResetInfoPtr()->reason == REASON_DEEP_SLEEP_AWAKE;
+#elif defined(USE_HOST)
+  return global_host_sleep_hal->woke_from_deep_sleep();
+#else
+  return false;
+#endif
+}
+#endif
+
+#ifdef USE_TIME
+static const uint32_t DRIFT_STATE_MAGIC = 0x44524654;  // "DRFT"
+static const float DRIFT_ALPHA = 0.3f;
+// Clock readings have a resolution of one second, so shorter baselines keep accumulating
+static const uint64_t DRIFT_MIN_BASELINE_MS = 10 * 60 * 1000;
+#if defined(USE_ESP32) || defined(USE_HOST)
+static RTC_NOINIT_ATTR DriftState drift_state;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+#endif
+#endif
+
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+static const uint32_t SHUTDOWN_REPORT_MAGIC = 0x5344524E;  // "SDRN"
+#if defined(USE_ESP32) || defined(USE_HOST)
+static RTC_NOINIT_ATTR ShutdownReport shutdown_report;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+#endif
+#endif
+
+#ifdef USE_DEEP_SLEEP_JOURNAL
+static const uint32_t SAMPLE_JOURNAL_MAGIC = 0x4A524E4C;  // "JRNL"
+// Not initialized on boot; survives esp_deep_sleep_start() and is validated by crc on restore
+static RTC_NOINIT_ATTR SampleJournal sample_journal;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+static uint16_t journal_crc(const SampleJournal &journal) {
+  // crc covers every header field but itself, and the entries up to the last used one
+  const uint8_t *header = reinterpret_cast<const uint8_t *>(&journal);
+  uint16_t crc = crc16(header, offsetof(SampleJournal, crc));
+  const uint8_t *start = reinterpret_cast<const uint8_t *>(&journal.clock_ms);
+  const uint8_t *end = reinterpret_cast<const uint8_t *>(&journal.entries[journal.count]);
+  return crc16(start, end - start, crc);
+}
+#endif
+
+WakeCause DeepSleepComponent::get_wake_cause_() const {
 #ifdef USE_ESP32
+  switch (esp_sleep_get_wakeup_cause()) {
+    case ESP_SLEEP_WAKEUP_EXT0:
+    case ESP_SLEEP_WAKEUP_EXT1:
+    case ESP_SLEEP_WAKEUP_GPIO:
+      return WAKE_CAUSE_GPIO;
+    case ESP_SLEEP_WAKEUP_TOUCHPAD:
+      return WAKE_CAUSE_TOUCH;
+    default:
+      break;
+  }
+#elif defined(USE_HOST)
+  return global_host_sleep_hal->get_wake_cause();
+#endif
+  return WAKE_CAUSE_DEFAULT;
+}
+
+optional<uint32_t> DeepSleepComponent::get_run_duration_() const {
+#if defined(USE_ESP32) || defined(USE_HOST)
   if (this->wakeup_cause_to_run_duration_.has_value()) {
-    esp_sleep_wakeup_cause_t wakeup_cause = esp_sleep_get_wakeup_cause();
-    switch (wakeup_cause) {
-      case ESP_SLEEP_WAKEUP_EXT0:
-      case ESP_SLEEP_WAKEUP_EXT1:
-      case ESP_SLEEP_WAKEUP_GPIO:
+    switch (this->get_wake_cause_()) {
+      case WAKE_CAUSE_GPIO:
         return this->wakeup_cause_to_run_duration_->gpio_cause;
-      case ESP_SLEEP_WAKEUP_TOUCHPAD:
+      case WAKE_CAUSE_TOUCH:
         return this->wakeup_cause_to_run_duration_->touch_cause;
       default:
         return this->wakeup_cause_to_run_duration_->default_cause;
@@ -44,18 +183,91 @@ void DeepSleepComponent::setup() {
   } else {
     ESP_LOGD(TAG, "Not scheduling Deep Sleep, as no run duration is configured.");
   }
+#ifdef USE_TEXT_SENSOR
+  if (this->inhibitors_text_sensor_ != nullptr)
+    this->inhibitors_text_sensor_->publish_state(this->describe_inhibitors_());
+#endif
+#ifdef USE_SENSOR
+  if (!this->required_sensors_.empty()) {
+    ESP_LOGD(TAG, "Deep Sleep will start once %zu sensors have published", this->required_sensors_.size());
+  }
+#endif
+#ifdef USE_SENSOR
+  if (this->adaptive_sensor_ != nullptr)
+    this->restore_adaptive_state_();
+  if (this->has_wake_metric_sensors_())
+    this->restore_wake_metrics_();
+#endif
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  if (this->journal_sensor_ != nullptr)
+    this->restore_journal_();
+#endif
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+  this->collect_shutdown_hooks_();
+  this->restore_shutdown_report_();
+#endif
+#ifdef USE_TIME
+  if (this->time_ != nullptr && this->drift_correction_) {
+    this->restore_drift_state_();
+    this->time_->add_on_time_sync_callback([this]() { this->measure_drift_(); });
+  }
+#endif
 }
 
 void DeepSleepComponent::dump_config() {
   ESP_LOGCONFIG(TAG, "Setting up Deep Sleep...");
   if (this->sleep_duration_.has_value()) {
-    uint32_t duration = static_cast<uint32_t>(*this->sleep_duration_ / 1000ULL);
-    ESP_LOGCONFIG(TAG, "  Sleep Duration: %" PRIu32 " ms", duration);
+    ESP_LOGCONFIG(TAG, "  Sleep Duration: %" PRIu64 " ms", *this->sleep_duration_ / 1000);
   }
   if (this->run_duration_.has_value()) {
     ESP_LOGCONFIG(TAG, "  Run Duration: %" PRIu32 " ms", *this->run_duration_);
   }
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
+  if (!this->inhibitors_.empty()) {
+    ESP_LOGCONFIG(TAG, "  Sleep Inhibitors: %s", this->describe_inhibitors_().c_str());
+  }
+#ifdef USE_SENSOR
+  for (auto *sensor : this->required_sensors_) {
+    LOG_SENSOR("  ", "Sleep After Publish", sensor);
+  }
+  if (!this->required_sensors_.empty()) {
+    ESP_LOGCONFIG(TAG, "  Publish Grace Delay: %" PRIu32 " ms", this->publish_grace_delay_);
+  }
+#endif
+#ifdef USE_SENSOR
+  if (this->adaptive_sensor_ != nullptr) {
+    const AdaptiveSleepConfig &c = this->adaptive_config_;
+    LOG_SENSOR("  ", "Adaptive Sleep Input", this->adaptive_sensor_);
+    LOG_SENSOR("  ", "Battery", this->battery_sensor_);
+    ESP_LOGCONFIG(TAG, "  Adaptive Sleep: %" PRIu32 "-%" PRIu32 " ms, fast change %.2f/min", c.min_sleep_ms,
+                  c.max_sleep_ms, c.fast_change);
+    if (c.lifetime_hours > 0)
+      ESP_LOGCONFIG(TAG, "  Lifetime Target: %.0f h on %.0f mAh", c.lifetime_hours, c.capacity_mah);
+    LOG_SENSOR("  ", "Next Sleep Duration", this->next_sleep_duration_sensor_);
+    LOG_SENSOR("  ", "Energy Floor", this->energy_floor_sensor_);
+    LOG_SENSOR("  ", "Average Current", this->average_current_sensor_);
+  }
+#endif
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  if (this->journal_sensor_ != nullptr) {
+    LOG_SENSOR("  ", "Journal", this->journal_sensor_);
+    ESP_LOGCONFIG(TAG, "  Journal Flush Every: %u wakes", this->journal_flush_every_);
+    if (this->journal_threshold_.has_value())
+      ESP_LOGCONFIG(TAG, "  Journal Threshold: %.1f", *this->journal_threshold_);
+  }
+#endif
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+  ESP_LOGCONFIG(TAG, "  Shutdown Hooks: %u, deadline %" PRIu32 " ms", (unsigned) this->shutdown_hooks_.size(),
+                this->shutdown_deadline_ms_);
+  if (this->shutdown_report_valid_)
+    ESP_LOGCONFIG(TAG, "  Previous Shutdown: %s", this->describe_shutdown_report_().c_str());
+#endif
+#ifdef USE_TIME
+  if (this->align_to_s_ != 0)
+    ESP_LOGCONFIG(TAG, "  Align Wake To: %" PRIu32 " s", this->align_to_s_);
+  if (this->drift_correction_)
+    ESP_LOGCONFIG(TAG, "  Drift Correction: %.4f", this->drift_state_.correction);
+#endif
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
   if (wakeup_pin_ != nullptr) {
     LOG_PIN("  Wakeup Pin: ", this->wakeup_pin_);
   }
@@ -76,22 +288,570 @@ void DeepSleepComponent::dump_config() {
 }
 
 void DeepSleepComponent::loop() {
-  if (this->next_enter_deep_sleep_)
+  // A sleep deferred by an inhibitor is resumed by release_inhibitor_(), not polled here
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
+  // Set from the wakeup pin ISR; bounces while a pin is still held keep the interrupts armed
+  if (this->wakeup_pin_changed_) {
+    this->wakeup_pin_changed_ = false;
+    bool held = std::any_of(this->armed_wakeup_pins_.begin(), this->armed_wakeup_pins_.end(),
+                            [](InternalGPIOPin *pin) { return pin->digital_read(); });
+    if (!held) {
+      this->disarm_wakeup_pins_();
+      this->begin_sleep();
+    }
+  }
+#endif
+#ifdef USE_SENSOR
+  this->check_required_published_();
+  this->publish_wake_metrics_();
+#endif
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  this->check_journal_flush_();
+#endif
+}
+
+#ifdef USE_SENSOR
+void DeepSleepComponent::add_required_sensor(sensor::Sensor *sensor) {
+  uint32_t bit = 1UL << this->required_sensors_.size();
+  this->required_sensors_.push_back(sensor);
+  sensor->add_on_state_callback([this, bit](float state) { this->required_published_ |= bit; });
+}
+
+bool DeepSleepComponent::all_required_published_() const {
+  uint32_t all = (1UL << this->required_sensors_.size()) - 1;
+  return this->required_published_ == all;
+}
+
+void DeepSleepComponent::check_required_published_() {
+  if (this->required_sensors_.empty() || this->publish_sleep_scheduled_ || !this->all_required_published_())
+    return;
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  // A pending journal flush schedules sleep itself once replayed
+  if (this->journal_flush_pending_)
+    return;
+#endif
+  // States only leave the device once a client is connected; keep waiting (up to run_duration) otherwise
+#ifdef USE_API
+  if (api::global_api_server != nullptr && !api::global_api_server->is_connected())
+    return;
+#endif
+#ifdef USE_MQTT
+  if (mqtt::global_mqtt_client != nullptr && !mqtt::global_mqtt_client->is_connected())
+    return;
+#endif
+  this->publish_sleep_scheduled_ = true;
+  ESP_LOGI(TAG, "All required sensors published; entering Deep Sleep in %" PRIu32 " ms", this->publish_grace_delay_);
+  // The grace delay lets the network stack flush the pending state messages
+  this->set_timeout("publish_grace", this->publish_grace_delay_, [this]() { this->begin_sleep(); });
+}
+#endif
+
+#ifdef USE_SENSOR
+void DeepSleepComponent::set_adaptive_sleep(sensor::Sensor *sensor, AdaptiveSleepConfig config) {
+  this->adaptive_sensor_ = sensor;
+  this->adaptive_config_ = config;
+  // Publish the decision as soon as the input is known so the diagnostics leave the device before sleep
+  sensor->add_on_state_callback([this](float state) { this->schedule_sleep_(); });
+}
+
+void DeepSleepComponent::restore_adaptive_state_() {
+#if defined(USE_ESP32) || defined(USE_HOST)
+  this->adaptive_state_ = adaptive_sleep_state;
+  this->adaptive_state_valid_ = true;
+#elif defined(USE_ESP8266)
+  this->adaptive_pref_ = global_preferences->make_preference<AdaptiveSleepState>(fnv1_hash("deep_sleep_adaptive"), false);
+  this->adaptive_state_valid_ = this->adaptive_pref_.load(&this->adaptive_state_);
+#endif
+  this->adaptive_state_valid_ &= woke_from_deep_sleep() && this->adaptive_state_.magic == ADAPTIVE_SLEEP_MAGIC;
+}
+
+void DeepSleepComponent::save_adaptive_state_() {
+  this->adaptive_state_.magic = ADAPTIVE_SLEEP_MAGIC;
+#if defined(USE_ESP32) || defined(USE_HOST)
+  adaptive_sleep_state = this->adaptive_state_;
+#elif defined(USE_ESP8266)
+  this->adaptive_pref_.save(&this->adaptive_state_);
+#endif
+}
+
+uint32_t DeepSleepComponent::schedule_sleep_() {
+  const AdaptiveSleepConfig &c = this->adaptive_config_;
+  float value = this->adaptive_sensor_->get_state();
+  uint32_t duration = c.max_sleep_ms;
+  const char *reason = "flat";
+
+  // Faster change between wakes -> shorter sleep, linear between max_sleep (no change) and min_sleep (fast_change)
+  if (this->adaptive_state_valid_ && !std::isnan(value) && !std::isnan(this->adaptive_state_.last_value) &&
+      c.fast_change > 0) {
+    // 64-bit so a long sleep plus the awake time cannot wrap
+    const uint64_t elapsed_ms = static_cast<uint64_t>(this->adaptive_state_.last_sleep_ms) + millis();
+    float minutes = std::max<uint64_t>(elapsed_ms, 1000) / 60000.0f;
+    float rate = std::fabs(value - this->adaptive_state_.last_value) / minutes;
+    float factor = clamp(1.0f - rate / c.fast_change, 0.0f, 1.0f);
+    duration = c.min_sleep_ms + static_cast<uint32_t>((c.max_sleep_ms - c.min_sleep_ms) * factor);
+    if (factor < 1.0f)
+      reason = "changing";
+  }
+  if (!std::isnan(c.alarm_threshold) && std::fabs(value - c.alarm_threshold) <= c.alarm_margin) {
+    duration = c.min_sleep_ms;
+    reason = "near alarm";
+  }
+
+  // Energy floor: the shortest sleep that still reaches the lifetime target at the current charge
+  uint32_t floor_ms = 0;
+  float average_ma = NAN;
+  float awake_ms = millis();
+  if (this->battery_sensor_ != nullptr && this->battery_sensor_->has_state() && c.capacity_mah > 0 &&
+      c.lifetime_hours > 0 && c.battery_full > c.battery_empty) {
+    float charge = clamp((this->battery_sensor_->get_state() - c.battery_empty) / (c.battery_full - c.battery_empty),
+                         0.0f, 1.0f);
+    float budget_ma = charge * c.capacity_mah / c.lifetime_hours;
+    if (budget_ma <= c.sleep_current_ma) {
+      floor_ms = c.max_sleep_ms;
+    } else if (c.awake_current_ma > budget_ma) {
+      float sleep_ms = awake_ms * (c.awake_current_ma - budget_ma) / (budget_ma - c.sleep_current_ma);
+      floor_ms = std::min<float>(sleep_ms, c.max_sleep_ms);
+    }
+    if (duration < floor_ms) {
+      duration = floor_ms;
+      reason = "battery";
+    }
+  }
+  duration = clamp(duration, c.min_sleep_ms, c.max_sleep_ms);
+  average_ma = (c.awake_current_ma * awake_ms + c.sleep_current_ma * duration) / (awake_ms + duration);
+
+  ESP_LOGD(TAG, "Adaptive sleep: %" PRIu32 " ms (%s), energy floor %" PRIu32 " ms, average %.2f mA", duration,
+           reason, floor_ms, average_ma);
+  if (this->next_sleep_duration_sensor_ != nullptr)
+    this->next_sleep_duration_sensor_->publish_state(duration / 1000.0f);
+  if (this->energy_floor_sensor_ != nullptr)
+    this->energy_floor_sensor_->publish_state(floor_ms / 1000.0f);
+  if (this->average_current_sensor_ != nullptr && c.awake_current_ma > 0)
+    this->average_current_sensor_->publish_state(average_ma);
+  return duration;
+}
+
+bool DeepSleepComponent::has_wake_metric_sensors_() const {
+  return this->wake_cause_sensor_ != nullptr || this->boot_time_sensor_ != nullptr ||
+         this->first_publish_time_sensor_ != nullptr || this->shutdown_time_sensor_ != nullptr ||
+         this->awake_time_sensor_ != nullptr || this->requested_sleep_sensor_ != nullptr ||
+         this->actual_sleep_sensor_ != nullptr || this->deferred_sleeps_sensor_ != nullptr;
+}
+
+void DeepSleepComponent::restore_wake_metrics_() {
+  bool loaded = false;
+#if defined(USE_ESP32) || defined(USE_HOST)
+  this->wake_metrics_ = wake_metrics;
+  loaded = true;
+#elif defined(USE_ESP8266)
+  this->wake_metrics_pref_ = global_preferences->make_preference<WakeMetrics>(fnv1_hash("deep_sleep_metrics"), false);
+  loaded = this->wake_metrics_pref_.load(&this->wake_metrics_);
+#endif
+  if (!loaded || !woke_from_deep_sleep() || this->wake_metrics_.magic != WAKE_METRICS_MAGIC) {
+    this->wake_metrics_ = WakeMetrics{};
+    this->wake_metrics_.magic = WAKE_METRICS_MAGIC;
+    this->wake_metrics_.avg_first_publish_ms = NAN;
+  } else if (this->wake_metrics_.sleep_start_us != 0) {
+    // Actual sleep including the time from wake to setup()
+    this->actual_sleep_ms_ = (system_time_us() - this->wake_metrics_.sleep_start_us) / 1000;
+  }
+  WakeMetrics &m = this->wake_metrics_;
+  m.cycles++;
+  this->wake_cause_ = this->get_wake_cause_();
+  this->boot_ms_ = millis();
+  m.avg_boot_ms = ewma(m.avg_boot_ms, this->boot_ms_, m.cycles);
+
+  // The first state published by any other sensor marks the end of useful work on this wake
+  sensor::Sensor *own[] = {this->wake_cause_sensor_,        this->boot_time_sensor_,
+                           this->first_publish_time_sensor_, this->shutdown_time_sensor_,
+                           this->awake_time_sensor_,         this->requested_sleep_sensor_,
+                           this->actual_sleep_sensor_,       this->deferred_sleeps_sensor_};
+  for (auto *sensor : App.get_sensors()) {
+    if (std::find(std::begin(own), std::end(own), sensor) != std::end(own))
+      continue;
+    sensor->add_on_state_callback([this](float state) {
+      if (!this->first_publish_ms_.has_value())
+        this->first_publish_ms_ = millis();
+    });
+  }
+}
+
+void DeepSleepComponent::save_wake_metrics_(uint32_t shutdown_ms) {
+  WakeMetrics &m = this->wake_metrics_;
+  m.requested_sleep_ms = this->sleep_duration_.value_or(0) / 1000ULL;
+  m.shutdown_ms = shutdown_ms;
+  m.awake_ms = millis();
+  m.deferred_prevent = this->deferred_prevent_;
+  m.deferred_pin = this->deferred_pin_;
+  m.avg_shutdown_ms = ewma(m.avg_shutdown_ms, shutdown_ms, m.cycles);
+  m.avg_awake_ms = ewma(m.avg_awake_ms, m.awake_ms, m.cycles);
+  if (this->first_publish_ms_.has_value())
+    m.avg_first_publish_ms = ewma(m.avg_first_publish_ms, *this->first_publish_ms_, m.cycles);
+  m.sleep_start_us = system_time_us();
+#if defined(USE_ESP32) || defined(USE_HOST)
+  wake_metrics = m;
+#elif defined(USE_ESP8266)
+  this->wake_metrics_pref_.save(&m);
+#endif
+}
+
+// Publishes the previous cycle's totals and the rolling averages once per wake, when states can leave the device
+void DeepSleepComponent::publish_wake_metrics_() {
+  if (this->wake_metrics_published_ || !this->has_wake_metric_sensors_())
+    return;
+#ifdef USE_API
+  if (api::global_api_server != nullptr && !api::global_api_server->is_connected())
+    return;
+#endif
+#ifdef USE_MQTT
+  if (mqtt::global_mqtt_client != nullptr && !mqtt::global_mqtt_client->is_connected())
+    return;
+#endif
+  this->wake_metrics_published_ = true;
+  const WakeMetrics &m = this->wake_metrics_;
+  if (this->wake_cause_sensor_ != nullptr)
+    this->wake_cause_sensor_->publish_state(this->wake_cause_);
+  if (this->boot_time_sensor_ != nullptr)
+    this->boot_time_sensor_->publish_state(m.avg_boot_ms);
+  if (this->first_publish_time_sensor_ != nullptr && !std::isnan(m.avg_first_publish_ms))
+    this->first_publish_time_sensor_->publish_state(m.avg_first_publish_ms);
+  if (m.cycles <= 1)
+    return;  // Nothing recorded for a previous cycle yet
+  if (this->shutdown_time_sensor_ != nullptr)
+    this->shutdown_time_sensor_->publish_state(m.avg_shutdown_ms);
+  if (this->awake_time_sensor_ != nullptr)
+    this->awake_time_sensor_->publish_state(m.avg_awake_ms);
+  if (this->requested_sleep_sensor_ != nullptr)
+    this->requested_sleep_sensor_->publish_state(m.requested_sleep_ms / 1000.0f);
+  if (this->actual_sleep_sensor_ != nullptr && this->actual_sleep_ms_.has_value())
+    this->actual_sleep_sensor_->publish_state(*this->actual_sleep_ms_ / 1000.0f);
+  if (this->deferred_sleeps_sensor_ != nullptr)
+    this->deferred_sleeps_sensor_->publish_state(m.deferred_prevent + m.deferred_pin);
+}
+#endif
+
+#ifdef USE_DEEP_SLEEP_JOURNAL
+void DeepSleepComponent::set_journal(sensor::Sensor *sensor, uint8_t flush_every) {
+  this->journal_sensor_ = sensor;
+  this->journal_flush_every_ = std::min<uint8_t>(std::max<uint8_t>(flush_every, 1), SAMPLE_JOURNAL_CAPACITY);
+  sensor->add_on_state_callback([this](float state) { this->on_journal_sample_(state); });
+}
+
+void DeepSleepComponent::restore_journal_() {
+  SampleJournal &journal = sample_journal;
+  bool valid = woke_from_deep_sleep() && journal.magic == SAMPLE_JOURNAL_MAGIC &&
+               journal.count <= SAMPLE_JOURNAL_CAPACITY && journal.crc == journal_crc(journal);
+  if (!valid) {
+    ESP_LOGD(TAG, "Sample journal not valid, starting a new one");
+    memset(&journal, 0, sizeof(journal));
+    journal.magic = SAMPLE_JOURNAL_MAGIC;
+    journal.crc = journal_crc(journal);
+  }
+  this->journal_boot_clock_ms_ = journal.clock_ms;
+  ESP_LOGD(TAG, "Sample journal holds %u entries", journal.count);
+}
+
+void DeepSleepComponent::save_journal_() { sample_journal.crc = journal_crc(sample_journal); }
+
+void DeepSleepComponent::on_journal_sample_(float value) {
+  // Only the first value of each wake is journaled
+  if (this->journal_sampled_ || std::isnan(value))
+    return;
+  this->journal_sampled_ = true;
+
+  SampleJournal &journal = sample_journal;
+  uint64_t now = this->journal_now_ms_();
+  if (journal.count == SAMPLE_JOURNAL_CAPACITY) {
+    // Still full after flushes that did not get through; the newest samples matter more than the oldest. Ages are
+    // counted back from the newest entry, so the new oldest entry's delta is never used
+    ESP_LOGW(TAG, "Sample journal full, dropping the oldest sample");
+    memmove(&journal.entries[0], &journal.entries[1], (SAMPLE_JOURNAL_CAPACITY - 1) * sizeof(SampleJournalEntry));
+    journal.entries[0].delta_s = 0;
+    journal.count--;
+  }
+  SampleJournalEntry &entry = journal.entries[journal.count++];
+  uint64_t delta_s = journal.count == 1 ? 0 : (now - journal.last_entry_ms) / 1000;
+  entry.delta_s = std::min<uint64_t>(delta_s, 0xFFFFFF);
+#ifdef USE_ESP32
+  entry.wake_cause = esp_sleep_get_wakeup_cause();
+#else
+  entry.wake_cause = this->get_wake_cause_();
+#endif
+  entry.value = value;
+  journal.last_entry_ms = now;
+  this->save_journal_();
+
+  bool threshold_crossed =
+      this->journal_threshold_.has_value() &&
+      (!journal.has_flushed || std::fabs(value - journal.last_flushed_value) >= *this->journal_threshold_);
+  if (journal.count < this->journal_flush_every_ && journal.count < SAMPLE_JOURNAL_CAPACITY && !threshold_crossed) {
+    ESP_LOGD(TAG, "Journaled sample %u/%u, skipping radio this wake", journal.count, this->journal_flush_every_);
     this->begin_sleep();
+    return;
+  }
+
+  ESP_LOGI(TAG, "Flushing %u journaled samples%s", journal.count, threshold_crossed ? " (threshold crossed)" : "");
+  this->journal_flush_pending_ = true;
+#ifdef USE_WIFI
+  if (wifi::global_wifi_component != nullptr && wifi::global_wifi_component->is_disabled())
+    wifi::global_wifi_component->enable();
+#endif
 }
 
-float DeepSleepComponent::get_loop_priority() const { return -100.0f; }
+void DeepSleepComponent::check_journal_flush_() {
+  if (!this->journal_flush_pending_)
+    return;
+#ifdef USE_WIFI
+  if (wifi::global_wifi_component != nullptr && !wifi::global_wifi_component->is_connected())
+    return;
+#endif
+#ifdef USE_API
+  if (api::global_api_server != nullptr && !api::global_api_server->is_connected())
+    return;
+#endif
+#ifdef USE_MQTT
+  if (mqtt::global_mqtt_client != nullptr && !mqtt::global_mqtt_client->is_connected())
+    return;
+#endif
+  this->journal_flush_pending_ = false;
 
-void DeepSleepComponent::set_sleep_duration(uint32_t time_ms) {
-  this->sleep_duration_ = static_cast<uint64_t>(time_ms) * 1000ULL;
+  // Replay oldest first with each sample's age in seconds relative to now
+  SampleJournal &journal = sample_journal;
+  uint64_t age_ms = this->journal_now_ms_() - journal.last_entry_ms;
+  uint32_t ages[SAMPLE_JOURNAL_CAPACITY];
+  for (int i = journal.count - 1; i >= 0; i--) {
+    ages[i] = age_ms / 1000;
+    age_ms += static_cast<uint64_t>(journal.entries[i].delta_s) * 1000;
+  }
+  for (uint8_t i = 0; i < journal.count; i++) {
+    const SampleJournalEntry &entry = journal.entries[i];
+    for (auto *trigger : this->journal_flush_triggers_)
+      trigger->trigger(entry.value, ages[i], entry.wake_cause);
+  }
+
+  journal.last_flushed_value = journal.entries[journal.count - 1].value;
+  journal.has_flushed = true;
+  journal.count = 0;
+  this->save_journal_();
+
+  this->set_timeout("journal_flush", this->publish_grace_delay_, [this]() { this->begin_sleep(); });
 }
+#endif
 
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
+#ifdef USE_TIME
+void DeepSleepComponent::restore_drift_state_() {
+  bool valid = false;
+#if defined(USE_ESP32) || defined(USE_HOST)
+  this->drift_state_ = drift_state;
+  valid = true;
+#elif defined(USE_ESP8266)
+  this->drift_pref_ = global_preferences->make_preference<DriftState>(fnv1_hash("deep_sleep_drift"), false);
+  valid = this->drift_pref_.load(&this->drift_state_);
+#endif
+  const float correction = this->drift_state_.correction;
+  if (!valid || !woke_from_deep_sleep() || this->drift_state_.magic != DRIFT_STATE_MAGIC || !(correction > 0.8f) ||
+      !(correction < 1.2f)) {
+    this->drift_state_ = DriftState{DRIFT_STATE_MAGIC, 1.0f, 0, 0, 0};
+  } else if (this->get_wake_cause_() != WAKE_CAUSE_DEFAULT) {
+    // A pin or touch wake ended the timer sleep early
+    this->drift_state_.anchor = 0;
+  }
+}
+
+void DeepSleepComponent::save_drift_state_() {
+  this->drift_state_.magic = DRIFT_STATE_MAGIC;
+#if defined(USE_ESP32) || defined(USE_HOST)
+  drift_state = this->drift_state_;
+#elif defined(USE_ESP8266)
+  this->drift_pref_.save(&this->drift_state_);
+#endif
+}
+
+void DeepSleepComponent::measure_drift_() {
+  if (this->time_synced_)
+    return;
+  this->time_synced_ = true;
+  DriftState &state = this->drift_state_;
+  if (state.anchor == 0 || state.requested_ms < DRIFT_MIN_BASELINE_MS)
+    return;
+
+  // Wall time since the anchor, minus the time spent awake, is what the timer actually slept
+  const int64_t now = this->time_->utcnow().timestamp;
+  const int64_t slept_ms = (now - state.anchor) * 1000LL - millis() - state.awake_ms;
+  const float ratio = static_cast<float>(static_cast<double>(slept_ms) / static_cast<double>(state.requested_ms));
+  if (ratio > 0.8f && ratio < 1.2f) {
+    state.correction += DRIFT_ALPHA * (ratio - state.correction);
+    ESP_LOGD(TAG, "Slept %.4fx the requested time, correction %.4f", ratio, state.correction);
+  } else {
+    ESP_LOGW(TAG, "Ignoring implausible sleep drift %.4f", ratio);
+  }
+  state.anchor = 0;
+  this->save_drift_state_();
+}
+
+void DeepSleepComponent::align_sleep_() {
+  const ESPTime now = this->time_->utcnow();
+  if (!now.is_valid()) {
+    ESP_LOGW(TAG, "Time not valid, not aligning the wake");
+    return;
+  }
+  const uint64_t period = this->align_to_s_;
+  const uint64_t start = now.timestamp;
+  // The boundary nearest to the planned wake, always in the future
+  const uint64_t wake = start + this->sleep_duration_.value_or(0) / 1000000ULL;
+  uint64_t target = (wake + period / 2) / period * period;
+  if (target <= start)
+    target += period;
+  ESP_LOGD(TAG, "Waking at epoch %" PRIu64, target);
+  this->set_sleep_duration((target - start) * 1000ULL);
+}
+
+void DeepSleepComponent::correct_sleep_() {
+  DriftState &state = this->drift_state_;
+  if (!this->sleep_duration_.has_value()) {
+    // Not a timer wake, nothing to measure against
+    state.anchor = 0;
+  } else {
+    *this->sleep_duration_ = static_cast<uint64_t>(static_cast<double>(*this->sleep_duration_) / state.correction);
+    if (state.anchor != 0) {
+      state.awake_ms += millis();
+      state.requested_ms += *this->sleep_duration_ / 1000ULL;
+    } else if (this->time_synced_) {
+      state.anchor = this->time_->utcnow().timestamp;
+      state.awake_ms = 0;
+      state.requested_ms = *this->sleep_duration_ / 1000ULL;
+    }
+  }
+  this->save_drift_state_();
+}
+#endif
+
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+// Every component of the application, in the order Application::setup() sorted them by setup priority. The list is
+// final by the time any setup() runs.
+void DeepSleepComponent::collect_shutdown_hooks_() {
+  this->shutdown_hooks_.clear();
+  for (Component *component : App.get_components()) {
+    const bool critical =
+        std::find(this->critical_shutdown_components_.begin(), this->critical_shutdown_components_.end(),
+                  component) != this->critical_shutdown_components_.end();
+    this->shutdown_hooks_.push_back({component, critical, false, 0});
+  }
+}
+
+// Same order as Application::run_safe_shutdown_hooks(), the reverse of the setup order, but timed per component and
+// bounded by the deadline, which counts from the decision to sleep. A hook that is already running is not
+// interrupted, and the deadline only decides which components start shutting down: one whose on_safe_shutdown() ran
+// also gets on_shutdown().
+void DeepSleepComponent::run_shutdown_hooks_(uint32_t decision_ms) {
+  const uint32_t start = millis();
+  uint16_t skipped = 0;
+  for (auto &hook : this->shutdown_hooks_) {
+    hook.skipped = false;
+    hook.duration_us = 0;
+  }
+  for (bool safe : {true, false}) {
+    for (auto it = this->shutdown_hooks_.rbegin(); it != this->shutdown_hooks_.rend(); ++it) {
+      ShutdownHook &hook = *it;
+      if (hook.skipped)
+        continue;
+      if (safe && !hook.critical && this->shutdown_deadline_ms_ != 0 &&
+          millis() - decision_ms >= this->shutdown_deadline_ms_) {
+        hook.skipped = true;
+        skipped++;
+        continue;
+      }
+      const uint32_t hook_start = micros();
+      if (safe) {
+        hook.component->on_safe_shutdown();
+      } else {
+        hook.component->on_shutdown();
+      }
+      hook.duration_us += micros() - hook_start;
+    }
+  }
+
+  ShutdownReport &report = this->shutdown_report_;
+  report.hook_count = this->shutdown_hooks_.size();
+  report.skipped = skipped;
+  report.hooks_ms = millis() - start;
+  report.decision_ms = millis() - decision_ms;
+  // Keep the slowest hooks, longest first
+  for (auto &slot : report.slowest) {
+    slot.hook = UINT16_MAX;
+    slot.duration_ms = 0;
+  }
+  for (uint16_t i = 0; i < report.hook_count; i++) {
+    const uint32_t duration_ms = this->shutdown_hooks_[i].duration_us / 1000;
+    if (duration_ms == 0 || duration_ms <= report.slowest[SHUTDOWN_REPORT_SLOTS - 1].duration_ms)
+      continue;
+    uint8_t pos = SHUTDOWN_REPORT_SLOTS - 1;
+    while (pos > 0 && duration_ms > report.slowest[pos - 1].duration_ms) {
+      report.slowest[pos] = report.slowest[pos - 1];
+      pos--;
+    }
+    report.slowest[pos].hook = i;
+    report.slowest[pos].duration_ms = std::min<uint32_t>(duration_ms, UINT16_MAX);
+  }
+  this->save_shutdown_report_();
+}
+
+void DeepSleepComponent::restore_shutdown_report_() {
+#if defined(USE_ESP32) || defined(USE_HOST)
+  this->shutdown_report_ = shutdown_report;
+  this->shutdown_report_valid_ = true;
+#elif defined(USE_ESP8266)
+  this->shutdown_report_pref_ =
+      global_preferences->make_preference<ShutdownReport>(fnv1_hash("deep_sleep_shutdown"), false);
+  this->shutdown_report_valid_ = this->shutdown_report_pref_.load(&this->shutdown_report_);
+#endif
+  // A report from different firmware would name the wrong components
+  this->shutdown_report_valid_ &= woke_from_deep_sleep() && this->shutdown_report_.magic == SHUTDOWN_REPORT_MAGIC &&
+                                  this->shutdown_report_.hook_count == this->shutdown_hooks_.size();
+  if (!this->shutdown_report_valid_)
+    return;
+  ESP_LOGD(TAG, "Previous shutdown: %s", this->describe_shutdown_report_().c_str());
+#ifdef USE_TEXT_SENSOR
+  // Sent to clients as soon as they connect
+  if (this->shutdown_report_text_sensor_ != nullptr)
+    this->shutdown_report_text_sensor_->publish_state(this->describe_shutdown_report_());
+#endif
+}
+
+void DeepSleepComponent::save_shutdown_report_() {
+  this->shutdown_report_.magic = SHUTDOWN_REPORT_MAGIC;
+#if defined(USE_ESP32) || defined(USE_HOST)
+  shutdown_report = this->shutdown_report_;
+#elif defined(USE_ESP8266)
+  this->shutdown_report_pref_.save(&this->shutdown_report_);
+#endif
+}
+
+std::string DeepSleepComponent::describe_shutdown_report_() const {
+  const ShutdownReport &report = this->shutdown_report_;
+  std::string out = to_string(report.decision_ms) + " ms total, hooks " + to_string(report.hooks_ms) + " ms";
+  for (const auto &slot : report.slowest) {
+    if (slot.hook >= this->shutdown_hooks_.size())
+      break;
+    out += ", " + std::string(this->shutdown_hooks_[slot.hook].component->get_component_source()) + " " +
+           to_string(slot.duration_ms) + " ms";
+  }
+  if (report.skipped != 0)
+    out += ", " + to_string(report.skipped) + " skipped";
+  return out;
+}
+#endif
+
+float DeepSleepComponent::get_loop_priority() const { return -100.0f; }
+
+void DeepSleepComponent::set_sleep_duration(uint64_t time_ms) { this->sleep_duration_ = time_ms * 1000ULL; }
+
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
 void DeepSleepComponent::set_wakeup_pin_mode(WakeupPinMode wakeup_pin_mode) { this->wakeup_pin_mode_ = wakeup_pin_mode; }
 #endif
 
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
-#if !defined(USE_ESP32_VARIANT_ESP32C3) && !defined(USE_LIBRETINY)
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
+#if defined(USE_ESP32) && !defined(USE_ESP32_VARIANT_ESP32C3)
 void DeepSleepComponent::set_ext1_wakeup(Ext1Wakeup ext1_wakeup) { this->ext1_wakeup_ = ext1_wakeup; }
 void DeepSleepComponent::set_touch_wakeup(bool touch_wakeup) { this->touch_wakeup_ = touch_wakeup; }
 #endif
@@ -99,29 +859,55 @@ void DeepSleepComponent::set_touch_wakeup(bool touch_wakeup) { this->touch_wakeu
 void DeepSleepComponent::set_run_duration(WakeupCauseToRunDuration wakeup_cause_to_run_duration) {
   wakeup_cause_to_run_duration_ = wakeup_cause_to_run_duration;
 }
-#endif
+
+void IRAM_ATTR DeepSleepComponent::wakeup_pin_isr_(DeepSleepComponent *arg) { arg->wakeup_pin_changed_ = true; }
 
 bool DeepSleepComponent::prepare_pin(InternalGPIOPin *pin, WakeupPinMode pin_mode) {
   if (pin_mode == WAKEUP_PIN_MODE_KEEP_AWAKE && pin != nullptr &&
       !this->sleep_duration_.has_value() && pin->digital_read()) {
-    if (!this->next_enter_deep_sleep_) {
+    // One deferral until the sleep goes ahead, however often the pin bounces
+    if (!this->pin_deferred_) {
+      this->pin_deferred_ = true;
+#ifdef USE_SENSOR
+      this->deferred_pin_++;
+#endif
       this->status_set_warning();
       ESP_LOGW(TAG, "Wakeup pin active; deferring deep sleep until inactive...");
     }
-    this->next_enter_deep_sleep_ = true;
+    // Wait for the release edge instead of polling the pin from loop()
+    if (std::find(this->armed_wakeup_pins_.begin(), this->armed_wakeup_pins_.end(), pin) ==
+        this->armed_wakeup_pins_.end()) {
+      pin->attach_interrupt(&DeepSleepComponent::wakeup_pin_isr_, this, gpio::INTERRUPT_ANY_EDGE);
+      this->armed_wakeup_pins_.push_back(pin);
+    }
+    // The pin may have been released before the interrupt was attached
+    if (!pin->digital_read())
+      this->wakeup_pin_changed_ = true;
     return false;
   }
   return true;
 }
 
+void DeepSleepComponent::disarm_wakeup_pins_() {
+  for (auto *pin : this->armed_wakeup_pins_)
+    pin->detach_interrupt();
+  this->armed_wakeup_pins_.clear();
+}
+#endif
+
 void DeepSleepComponent::set_run_duration(uint32_t time_ms) { this->run_duration_ = time_ms; }
 
 void DeepSleepComponent::begin_sleep(bool manual) {
-  if (this->prevent_ && !manual) {
+  if (!this->inhibitors_.empty() && !manual) {
+#ifdef USE_SENSOR
+    if (!this->next_enter_deep_sleep_)
+      this->deferred_prevent_++;
+#endif
     this->next_enter_deep_sleep_ = true;
     return;
   }
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
+  this->next_enter_deep_sleep_ = false;
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
   if (!prepare_pin(this->wakeup_pin_, this->wakeup_pin_mode_))
     return;
 #endif
@@ -133,12 +919,58 @@ void DeepSleepComponent::begin_sleep(bool manual) {
     }
   }
 #endif
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+  const uint32_t decision_ms = millis();
+#endif
+
+#ifdef USE_SENSOR
+  if (this->adaptive_sensor_ != nullptr && !manual) {
+    uint32_t duration = this->schedule_sleep_();
+    this->set_sleep_duration(duration);
+    this->adaptive_state_.last_value = this->adaptive_sensor_->get_state();
+    this->adaptive_state_.last_sleep_ms = duration;
+    this->save_adaptive_state_();
+  }
+#endif
+#ifdef USE_TIME
+  if (this->align_to_s_ != 0 && !manual)
+    this->align_sleep_();
+#endif
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  if (this->journal_sensor_ != nullptr) {
+    // Advance the journal clock to the expected wake time
+    sample_journal.clock_ms = this->journal_now_ms_() + this->sleep_duration_.value_or(0) / 1000ULL;
+    this->save_journal_();
+  }
+#endif
+#ifdef USE_TIME
+  if (this->time_ != nullptr && this->drift_correction_)
+    this->correct_sleep_();
+#endif
+#ifdef USE_LIBRETINY
+  // The LibreTiny timer takes 32-bit milliseconds
+  if (this->sleep_duration_.has_value() && *this->sleep_duration_ / 1000ULL > UINT32_MAX) {
+    ESP_LOGW(TAG, "Sleep duration capped to %" PRIu32 " ms", UINT32_MAX);
+    this->sleep_duration_ = UINT32_MAX * 1000ULL;
+  }
+#endif
 
   ESP_LOGI(TAG, "Beginning Deep Sleep");
   if (this->sleep_duration_.has_value()) {
     ESP_LOGI(TAG, "Sleeping for %" PRId64 "us", *this->sleep_duration_);
   }
+#ifdef USE_SENSOR
+  uint32_t shutdown_start = millis();
+#endif
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+  this->run_shutdown_hooks_(decision_ms);
+#else
   App.run_safe_shutdown_hooks();
+#endif
+#ifdef USE_SENSOR
+  if (this->has_wake_metric_sensors_())
+    this->save_wake_metrics_(millis() - shutdown_start);
+#endif
 
 #if defined(USE_ESP32) || defined(USE_LIBRETINY)
 #if !defined(USE_ESP32_VARIANT_ESP32C3) && !defined(USE_LIBRETINY)
@@ -164,7 +996,7 @@ void DeepSleepComponent::begin_sleep(bool manual) {
   if (this->sleep_duration_.has_value())
 #if defined(USE_LIBRETINY)
     // LibreTiny timer API expects milliseconds
-    lt_deep_sleep_config_timer(static_cast<uint32_t>((*this->sleep_duration_ / 1000ULL) & 0xFFFFFFFF));
+    lt_deep_sleep_config_timer(static_cast<uint32_t>(*this->sleep_duration_ / 1000ULL));
 #else
     esp_sleep_enable_timer_wakeup(*this->sleep_duration_);
 #endif
@@ -206,11 +1038,98 @@ void DeepSleepComponent::begin_sleep(bool manual) {
     ESP.deepSleep(0);  // sleep indefinitely until reset
   }
 #endif
+
+#ifdef USE_HOST
+  HostSleepRequest request{this->sleep_duration_, this->wakeup_pin_, false};
+  if (this->wakeup_pin_ != nullptr) {
+    request.wakeup_level = !this->wakeup_pin_->is_inverted();
+    if (this->wakeup_pin_mode_ == WAKEUP_PIN_MODE_INVERT_WAKEUP && this->wakeup_pin_->digital_read()) {
+      request.wakeup_level = !request.wakeup_level;
+    }
+  }
+  global_host_sleep_hal->deep_sleep(request);
+#endif
 }
 
 float DeepSleepComponent::get_setup_priority() const { return setup_priority::LATE; }
-void DeepSleepComponent::prevent_deep_sleep() { this->prevent_ = true; }
-void DeepSleepComponent::allow_deep_sleep() { this->prevent_ = false; }
+// The unnamed holder keeps the old on/off semantics
+void DeepSleepComponent::prevent_deep_sleep() {
+  for (auto &inhibitor : this->inhibitors_) {
+    if (inhibitor.name.empty())
+      return;
+  }
+  this->inhibitors_.push_back({"", 1, millis()});
+  this->on_inhibitors_changed_();
+}
+
+void DeepSleepComponent::allow_deep_sleep() { this->allow_deep_sleep(""); }
+
+void DeepSleepComponent::prevent_deep_sleep(const std::string &holder, uint32_t max_hold_ms) {
+  for (auto &inhibitor : this->inhibitors_) {
+    if (inhibitor.name == holder) {
+      inhibitor.count++;
+      this->on_inhibitors_changed_();
+      return;
+    }
+  }
+  this->inhibitors_.push_back({holder, 1, millis()});
+  if (max_hold_ms != 0) {
+    // Bound the hold from the first acquire so a missing allow cannot keep the device awake forever
+    this->set_timeout("inhibit_" + holder, max_hold_ms, [this, holder]() {
+      auto it = std::find_if(this->inhibitors_.begin(), this->inhibitors_.end(),
+                             [&holder](const SleepInhibitor &inhibitor) { return inhibitor.name == holder; });
+      if (it == this->inhibitors_.end())
+        return;
+      ESP_LOGW(TAG, "Sleep inhibitor '%s' exceeded its maximum hold time, releasing", holder.c_str());
+      this->release_inhibitor_(it);
+    });
+  }
+  this->on_inhibitors_changed_();
+}
+
+void DeepSleepComponent::allow_deep_sleep(const std::string &holder) {
+  auto it = std::find_if(this->inhibitors_.begin(), this->inhibitors_.end(),
+                         [&holder](const SleepInhibitor &inhibitor) { return inhibitor.name == holder; });
+  if (it == this->inhibitors_.end())
+    return;
+  if (--it->count != 0) {
+    this->on_inhibitors_changed_();
+    return;
+  }
+  this->cancel_timeout("inhibit_" + holder);
+  this->release_inhibitor_(it);
+}
+
+void DeepSleepComponent::release_inhibitor_(std::vector<SleepInhibitor>::iterator it) {
+  this->inhibitors_.erase(it);
+  this->on_inhibitors_changed_();
+  // A sleep requested while held starts as soon as the last holder lets go
+  if (this->inhibitors_.empty() && this->next_enter_deep_sleep_) {
+    this->next_enter_deep_sleep_ = false;
+    this->begin_sleep();
+  }
+}
+
+std::string DeepSleepComponent::describe_inhibitors_() const {
+  std::string result;
+  for (const auto &inhibitor : this->inhibitors_) {
+    if (!result.empty())
+      result += ", ";
+    result += inhibitor.name.empty() ? "default" : inhibitor.name;
+    if (inhibitor.count > 1)
+      result += " x" + to_string(inhibitor.count);
+    result += " (" + to_string((millis() - inhibitor.since) / 1000) + "s)";
+  }
+  return result;
+}
+
+void DeepSleepComponent::on_inhibitors_changed_() {
+  ESP_LOGD(TAG, "Sleep inhibitors: %s", this->inhibitors_.empty() ? "none" : this->describe_inhibitors_().c_str());
+#ifdef USE_TEXT_SENSOR
+  if (this->inhibitors_text_sensor_ != nullptr)
+    this->inhibitors_text_sensor_->publish_state(this->describe_inhibitors_());
+#endif
+}
 
 }  // namespace deep_sleep
 }  // namespace esphome
@@ -4,6 +4,7 @@
 #include "esphome/core/component.h"
 #include "esphome/core/hal.h"
 #include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
 
 #ifdef USE_ESP32
 #include <esp_sleep.h>
@@ -14,15 +15,22 @@
 #include "esphome/core/time.h"
 #endif
 
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+#ifdef USE_TEXT_SENSOR
+#include "esphome/components/text_sensor/text_sensor.h"
+#endif
+
+#include <algorithm>
 #include <cinttypes>
-#ifdef USE_LIBRETINY
+#include <string>
 #include <vector>
-#endif
 
 namespace esphome {
 namespace deep_sleep {
 
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
 
 enum WakeupPinMode {
   WAKEUP_PIN_MODE_IGNORE = 0,
@@ -30,12 +38,12 @@ enum WakeupPinMode {
   WAKEUP_PIN_MODE_INVERT_WAKEUP,
 };
 
-#if !defined(USE_LIBRETINY)
+#if defined(USE_ESP32)
 struct Ext1Wakeup {
   uint64_t mask;
   esp_sleep_ext1_wakeup_mode_t wakeup_mode;
 };
-#else
+#elif defined(USE_LIBRETINY)
 struct WakeUpPinItem {
   InternalGPIOPin *wakeup_pin;
   WakeupPinMode wakeup_pin_mode;
@@ -50,21 +58,162 @@ struct WakeupCauseToRunDuration {
 
 #endif
 
+#if (defined(USE_ESP32) || defined(USE_HOST)) && defined(USE_SENSOR)
+#define USE_DEEP_SLEEP_JOURNAL
+
+static const uint8_t SAMPLE_JOURNAL_CAPACITY = 32;
+
+/// One journaled sample, 8 bytes.
+struct SampleJournalEntry {
+  uint32_t delta_s : 24;     ///< Seconds since the previous entry (or since the journal was cleared)
+  uint32_t wake_cause : 8;   ///< esp_sleep_wakeup_cause_t of the wake that took the sample (WakeCause on the host)
+  float value;
+};
+
+/// Fixed-layout sample journal kept in RTC slow memory across deep sleep.
+struct SampleJournal {
+  uint32_t magic;
+  uint8_t count;
+  uint8_t has_flushed;
+  uint16_t crc;
+  uint64_t clock_ms;        ///< Estimated time when the device wakes next (awake time + sleep duration)
+  uint64_t last_entry_ms;   ///< Clock of the newest entry
+  float last_flushed_value;
+  SampleJournalEntry entries[SAMPLE_JOURNAL_CAPACITY];
+};
+
+class JournalFlushTrigger : public Trigger<float, uint32_t, uint8_t> {};
+#endif
+
+/// Wake causes as grouped for the per-cause run durations.
+enum WakeCause : uint8_t {
+  WAKE_CAUSE_DEFAULT = 0,
+  WAKE_CAUSE_TOUCH,
+  WAKE_CAUSE_GPIO,
+};
+
+#ifdef USE_HOST
+/// The wakeup sources begin_sleep() armed on the host.
+struct HostSleepRequest {
+  optional<uint64_t> sleep_duration_us;  ///< Timer wakeup
+  InternalGPIOPin *wakeup_pin;
+  bool wakeup_level;  ///< Level of wakeup_pin that wakes the device
+};
+
+/// Stands in for the sleep hardware on the host. The default waits out the timer wakeup and restarts the process;
+/// a simulator replaces it to record the request and decide when and why the device wakes.
+class HostSleepHal {
+ public:
+  virtual ~HostSleepHal() = default;
+  /// Enter deep sleep. May return, in which case the main loop must not run again until the next boot.
+  virtual void deep_sleep(const HostSleepRequest &request);
+  virtual bool woke_from_deep_sleep() { return false; }
+  virtual WakeCause get_wake_cause() { return WAKE_CAUSE_DEFAULT; }
+  /// System time in microseconds, which the RTC keeps running through deep sleep.
+  virtual int64_t system_time_us();
+};
+
+extern HostSleepHal *global_host_sleep_hal;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+#endif
+
+#ifdef USE_SENSOR
+/// Inputs of the adaptive sleep scheduler; zero/NAN fields are unused.
+struct AdaptiveSleepConfig {
+  uint32_t min_sleep_ms;
+  uint32_t max_sleep_ms;
+  float fast_change;      ///< Change per minute at which min_sleep is used
+  float alarm_threshold;  ///< Sleep min_sleep while the value is within alarm_margin of this
+  float alarm_margin;
+  float battery_empty;    ///< Battery voltage at 0% / 100%
+  float battery_full;
+  float capacity_mah;
+  float lifetime_hours;   ///< Remaining runtime to reach at the current charge
+  float awake_current_ma;
+  float sleep_current_ma;
+};
+
+/// Per-cycle timing kept across deep sleep; `avg_*` are exponentially weighted averages.
+struct WakeMetrics {
+  uint32_t magic;
+  uint32_t cycles;
+  uint32_t requested_sleep_ms;  ///< Of the previous sleep
+  uint32_t shutdown_ms;         ///< Time in the safe shutdown hooks before the previous sleep
+  uint32_t awake_ms;            ///< Boot to sleep of the previous wake
+  uint16_t deferred_prevent;    ///< Sleeps deferred by prevent during the previous wake
+  uint16_t deferred_pin;        ///< Sleeps deferred by a keep-awake wakeup pin during the previous wake
+  int64_t sleep_start_us;       ///< System time when the previous sleep started (0 = unknown)
+  float avg_boot_ms;
+  float avg_first_publish_ms;
+  float avg_shutdown_ms;
+  float avg_awake_ms;
+};
+
+/// Kept across deep sleep to measure the rate of change between wakes.
+struct AdaptiveSleepState {
+  uint32_t magic;
+  uint32_t last_sleep_ms;
+  float last_value;
+};
+#endif
+
+#ifdef USE_TIME
+/// Slow clock error measured between two wakes that had a synchronized clock, kept across deep sleep.
+struct DriftState {
+  uint32_t magic;
+  float correction;       ///< Actual / requested timer sleep, exponentially weighted
+  uint32_t anchor;        ///< UTC epoch when the first timer sleep of the measurement started (0 = none)
+  uint32_t awake_ms;      ///< Awake time of the unsynchronized wakes since the anchor
+  uint64_t requested_ms;  ///< Timer sleep programmed since the anchor
+};
+#endif
+
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+static const uint8_t SHUTDOWN_REPORT_SLOTS = 4;
+
+/// A component whose shutdown hooks deep_sleep runs and times individually, in the application's component order.
+struct ShutdownHook {
+  Component *component;
+  bool critical;     ///< Runs even after the deadline has passed
+  bool skipped;
+  uint32_t duration_us;
+};
+
+/// Shutdown timing of the previous sleep, kept across deep sleep and reported on the next wake.
+struct ShutdownReport {
+  uint32_t magic;
+  uint16_t hook_count;  ///< Number of registered hooks, to match indices against this firmware
+  uint16_t skipped;
+  uint32_t decision_ms;  ///< From the decision to sleep until the hooks had finished
+  uint32_t hooks_ms;
+  struct {
+    uint16_t hook;  ///< Index into the hook list, UINT16_MAX = unused
+    uint16_t duration_ms;
+  } slowest[SHUTDOWN_REPORT_SLOTS];
+};
+#endif
+
+/// A named reason to stay awake. The unnamed holder used by prevent_deep_sleep() is not counted.
+struct SleepInhibitor {
+  std::string name;
+  uint16_t count;
+  uint32_t since;  ///< millis() of the first acquire
+};
+
 template<typename... Ts> class EnterDeepSleepAction;
 template<typename... Ts> class PreventDeepSleepAction;
 
 class DeepSleepComponent : public Component {
  public:
-  void set_sleep_duration(uint32_t time_ms);
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
+  void set_sleep_duration(uint64_t time_ms);
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
   void set_wakeup_pin(InternalGPIOPin *pin) { this->wakeup_pin_ = pin; }
   void set_wakeup_pin_mode(WakeupPinMode wakeup_pin_mode);
 #endif
 #ifdef USE_LIBRETINY
   void add_wakeup_pin(const WakeUpPinItem pin) { this->wakeup_pins_.push_back(pin); }
 #endif
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
-#if !defined(USE_ESP32_VARIANT_ESP32C3) && !defined(USE_LIBRETINY)
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
+#if defined(USE_ESP32) && !defined(USE_ESP32_VARIANT_ESP32C3)
   void set_ext1_wakeup(Ext1Wakeup ext1_wakeup);
   void set_touch_wakeup(bool touch_wakeup);
 #endif
@@ -73,6 +222,46 @@ class DeepSleepComponent : public Component {
 
   void set_run_duration(uint32_t time_ms);
 
+#ifdef USE_SENSOR
+  /// Sleep as soon as every required sensor has published once and the grace delay has passed.
+  /// run_duration remains the upper bound.
+  void add_required_sensor(sensor::Sensor *sensor);
+  void set_publish_grace_delay(uint32_t time_ms) { this->publish_grace_delay_ = time_ms; }
+#endif
+#ifdef USE_SENSOR
+  /// Pick the next sleep duration from `sensor` and the optional battery sensor before each automatic sleep.
+  void set_adaptive_sleep(sensor::Sensor *sensor, AdaptiveSleepConfig config);
+  void set_battery_sensor(sensor::Sensor *sensor) { this->battery_sensor_ = sensor; }
+  void set_next_sleep_duration_sensor(sensor::Sensor *sensor) { this->next_sleep_duration_sensor_ = sensor; }
+  void set_energy_floor_sensor(sensor::Sensor *sensor) { this->energy_floor_sensor_ = sensor; }
+  void set_average_current_sensor(sensor::Sensor *sensor) { this->average_current_sensor_ = sensor; }
+
+  /// Wake-to-wake metrics, published once per wake when the network is up
+  void set_wake_cause_sensor(sensor::Sensor *sensor) { this->wake_cause_sensor_ = sensor; }
+  void set_boot_time_sensor(sensor::Sensor *sensor) { this->boot_time_sensor_ = sensor; }
+  void set_first_publish_time_sensor(sensor::Sensor *sensor) { this->first_publish_time_sensor_ = sensor; }
+  void set_shutdown_time_sensor(sensor::Sensor *sensor) { this->shutdown_time_sensor_ = sensor; }
+  void set_awake_time_sensor(sensor::Sensor *sensor) { this->awake_time_sensor_ = sensor; }
+  void set_requested_sleep_sensor(sensor::Sensor *sensor) { this->requested_sleep_sensor_ = sensor; }
+  void set_actual_sleep_sensor(sensor::Sensor *sensor) { this->actual_sleep_sensor_ = sensor; }
+  void set_deferred_sleeps_sensor(sensor::Sensor *sensor) { this->deferred_sleeps_sensor_ = sensor; }
+#endif
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  /// Journal the first value of `sensor` on each wake; bring the radio up only every `flush_every` wakes or when
+  /// the value moved by at least the threshold since the last flush.
+  void set_journal(sensor::Sensor *sensor, uint8_t flush_every);
+  void set_journal_threshold(float threshold) { this->journal_threshold_ = threshold; }
+  void add_journal_flush_trigger(JournalFlushTrigger *trigger) { this->journal_flush_triggers_.push_back(trigger); }
+#endif
+
+#ifdef USE_TIME
+  void set_time(time::RealTimeClock *time) { this->time_ = time; }
+  /// Wake on the next UTC epoch multiple of `period_s` instead of after a fixed duration.
+  void set_align_to(uint32_t period_s) { this->align_to_s_ = period_s; }
+  /// Scale timer sleeps by the measured slow clock error.
+  void set_drift_correction(bool drift_correction) { this->drift_correction_ = drift_correction; }
+#endif
+
   void setup() override;
   void dump_config() override;
   void loop() override;
@@ -83,26 +272,170 @@ class DeepSleepComponent : public Component {
 
   void prevent_deep_sleep();
   void allow_deep_sleep();
+  /// Hold the device awake for `holder`; each call must be matched by allow_deep_sleep(holder).
+  /// A non-zero max_hold_ms releases the holder after that long regardless.
+  void prevent_deep_sleep(const std::string &holder, uint32_t max_hold_ms = 0);
+  void allow_deep_sleep(const std::string &holder);
+#ifdef USE_TEXT_SENSOR
+  void set_inhibitors_text_sensor(text_sensor::TextSensor *sensor) { this->inhibitors_text_sensor_ = sensor; }
+#endif
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+  /// Shut `component` down even once the deadline has passed.
+  void add_critical_shutdown_component(Component *component) {
+    this->critical_shutdown_components_.push_back(component);
+  }
+  /// Skip the remaining non-critical components once this much time has passed since the decision to sleep;
+  /// 0 = no deadline.
+  void set_shutdown_deadline(uint32_t deadline_ms) { this->shutdown_deadline_ms_ = deadline_ms; }
+#ifdef USE_TEXT_SENSOR
+  void set_shutdown_report_text_sensor(text_sensor::TextSensor *sensor) { this->shutdown_report_text_sensor_ = sensor; }
+#endif
+#endif
 
  protected:
   optional<uint32_t> get_run_duration_() const;
+  WakeCause get_wake_cause_() const;
+#ifdef USE_SENSOR
+  bool all_required_published_() const;
+  void check_required_published_();
+#endif
+#ifdef USE_SENSOR
+  void restore_adaptive_state_();
+  void save_adaptive_state_();
+  /// Returns the chosen sleep duration in ms and publishes the diagnostics.
+  uint32_t schedule_sleep_();
+
+  void restore_wake_metrics_();
+  void save_wake_metrics_(uint32_t shutdown_ms);
+  bool has_wake_metric_sensors_() const;
+  void publish_wake_metrics_();
+#endif
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  void restore_journal_();
+  void save_journal_();
+  uint64_t journal_now_ms_() const { return this->journal_boot_clock_ms_ + millis(); }
+  void on_journal_sample_(float value);
+  void check_journal_flush_();
+#endif
+
+#ifdef USE_TIME
+  void restore_drift_state_();
+  void save_drift_state_();
+  void measure_drift_();
+  void align_sleep_();
+  void correct_sleep_();
+#endif
+
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+  void collect_shutdown_hooks_();
+  void run_shutdown_hooks_(uint32_t decision_ms);
+  void restore_shutdown_report_();
+  void save_shutdown_report_();
+  std::string describe_shutdown_report_() const;
+#endif
 
   optional<uint64_t> sleep_duration_;
-#if defined(USE_ESP32) || defined(USE_LIBRETINY)
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
   InternalGPIOPin *wakeup_pin_{nullptr};
   WakeupPinMode wakeup_pin_mode_{WAKEUP_PIN_MODE_IGNORE};
-#if !defined(USE_LIBRETINY)
+#if defined(USE_ESP32)
   optional<Ext1Wakeup> ext1_wakeup_;
   optional<bool> touch_wakeup_;
-#else
+#elif defined(USE_LIBRETINY)
   std::vector<WakeUpPinItem> wakeup_pins_;
 #endif
   optional<WakeupCauseToRunDuration> wakeup_cause_to_run_duration_;
 #endif
   optional<uint32_t> run_duration_;
   bool next_enter_deep_sleep_{false};
-  bool prevent_{false};
+  std::vector<SleepInhibitor> inhibitors_;
+  void release_inhibitor_(std::vector<SleepInhibitor>::iterator it);
+  std::string describe_inhibitors_() const;
+  void on_inhibitors_changed_();
+#ifdef USE_TEXT_SENSOR
+  text_sensor::TextSensor *inhibitors_text_sensor_{nullptr};
+#endif
+#ifdef USE_SENSOR
+  std::vector<sensor::Sensor *> required_sensors_;
+  uint32_t required_published_{0};  // bit per required sensor
+  uint32_t publish_grace_delay_{500};
+  bool publish_sleep_scheduled_{false};
+#endif
+#ifdef USE_SENSOR
+  sensor::Sensor *adaptive_sensor_{nullptr};
+  sensor::Sensor *battery_sensor_{nullptr};
+  sensor::Sensor *next_sleep_duration_sensor_{nullptr};
+  sensor::Sensor *energy_floor_sensor_{nullptr};
+  sensor::Sensor *average_current_sensor_{nullptr};
+  AdaptiveSleepConfig adaptive_config_{};
+  AdaptiveSleepState adaptive_state_{};
+  bool adaptive_state_valid_{false};
+#ifdef USE_ESP8266
+  ESPPreferenceObject adaptive_pref_;
+#endif
+
+  WakeMetrics wake_metrics_{};
+  WakeCause wake_cause_{WAKE_CAUSE_DEFAULT};
+  uint32_t boot_ms_{0};
+  optional<uint32_t> first_publish_ms_;
+  optional<uint32_t> actual_sleep_ms_;
+  uint16_t deferred_prevent_{0};
+  uint16_t deferred_pin_{0};
+  bool wake_metrics_published_{false};
+  sensor::Sensor *wake_cause_sensor_{nullptr};
+  sensor::Sensor *boot_time_sensor_{nullptr};
+  sensor::Sensor *first_publish_time_sensor_{nullptr};
+  sensor::Sensor *shutdown_time_sensor_{nullptr};
+  sensor::Sensor *awake_time_sensor_{nullptr};
+  sensor::Sensor *requested_sleep_sensor_{nullptr};
+  sensor::Sensor *actual_sleep_sensor_{nullptr};
+  sensor::Sensor *deferred_sleeps_sensor_{nullptr};
+#ifdef USE_ESP8266
+  ESPPreferenceObject wake_metrics_pref_;
+#endif
+#endif
+#ifdef USE_DEEP_SLEEP_JOURNAL
+  sensor::Sensor *journal_sensor_{nullptr};
+  uint8_t journal_flush_every_{1};
+  optional<float> journal_threshold_;
+  std::vector<JournalFlushTrigger *> journal_flush_triggers_;
+  uint64_t journal_boot_clock_ms_{0};
+  bool journal_sampled_{false};
+  bool journal_flush_pending_{false};
+#endif
+#ifdef USE_TIME
+  time::RealTimeClock *time_{nullptr};
+  uint32_t align_to_s_{0};
+  bool drift_correction_{false};
+  bool time_synced_{false};
+  DriftState drift_state_{};
+#ifdef USE_ESP8266
+  ESPPreferenceObject drift_pref_;
+#endif
+#endif
+#ifdef USE_DEEP_SLEEP_SHUTDOWN_TIMING
+  std::vector<Component *> critical_shutdown_components_;
+  std::vector<ShutdownHook> shutdown_hooks_;
+  uint32_t shutdown_deadline_ms_{0};
+  ShutdownReport shutdown_report_{};
+  bool shutdown_report_valid_{false};
+#ifdef USE_ESP8266
+  ESPPreferenceObject shutdown_report_pref_;
+#endif
+#ifdef USE_TEXT_SENSOR
+  text_sensor::TextSensor *shutdown_report_text_sensor_{nullptr};
+#endif
+#endif
+#if defined(USE_ESP32) || defined(USE_LIBRETINY) || defined(USE_HOST)
   bool prepare_pin(InternalGPIOPin *pin, WakeupPinMode pin_mode);
+  void disarm_wakeup_pins_();
+  static void wakeup_pin_isr_(DeepSleepComponent *arg);
+
+  /// Keep-awake pins waiting for their release edge
+  std::vector<InternalGPIOPin *> armed_wakeup_pins_;
+  volatile bool wakeup_pin_changed_{false};
+  bool pin_deferred_{false};
+#endif
 };
 
 extern bool global_has_deep_sleep;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
@@ -110,13 +443,17 @@ extern bool global_has_deep_sleep;  // NOLINT(cppcoreguidelines-avoid-non-const-
 template<typename... Ts> class EnterDeepSleepAction : public Action<Ts...> {
  public:
   EnterDeepSleepAction(DeepSleepComponent *deep_sleep) : deep_sleep_(deep_sleep) {}
-  TEMPLATABLE_VALUE(uint32_t, sleep_duration);
+  TEMPLATABLE_VALUE(uint64_t, sleep_duration);
 
 #ifdef USE_TIME
   void set_until(uint8_t hour, uint8_t minute, uint8_t second) {
-    this->hour_ = hour;
-    this->minute_ = minute;
-    this->second_ = second;
+    this->until_ = hour * 3600 + minute * 60 + second;
+    this->set_schedule(&this->until_, 1);
+  }
+  /// Wake slots as local seconds of the day, sorted ascending (generated at codegen time).
+  void set_schedule(const uint32_t *slots, size_t size) {
+    this->schedule_ = slots;
+    this->schedule_size_ = size;
   }
 
   void set_time(time::RealTimeClock *time) { this->time_ = time; }
@@ -127,40 +464,13 @@ template<typename... Ts> class EnterDeepSleepAction : public Action<Ts...> {
       this->deep_sleep_->set_sleep_duration(this->sleep_duration_.value(x...));
     }
 #ifdef USE_TIME
-    if (this->hour_.has_value()) {
+    if (this->schedule_size_ != 0) {
       auto time = this->time_->now();
-      const uint32_t timestamp_now = time.timestamp;
-
-      bool after_time = false;
-      if (time.hour > this->hour_) {
-        after_time = true;
-      } else {
-        if (time.hour == this->hour_) {
-          if (time.minute > this->minute_) {
-            after_time = true;
-          } else {
-            if (time.minute == this->minute_) {
-              if (time.second > this->second_) {
-                after_time = true;
-              }
-            }
-          }
-        }
+      // Without a valid clock keep the configured sleep duration
+      if (time.is_valid()) {
+        const uint64_t ms_left = this->seconds_until_next_slot_(time) * 1000ULL;
+        this->deep_sleep_->set_sleep_duration(ms_left);
       }
-
-      time.hour = *this->hour_;
-      time.minute = *this->minute_;
-      time.second = *this->second_;
-      time.recalc_timestamp_utc();
-
-      time_t timestamp = time.timestamp;  // local time zone
-      if (after_time)
-        timestamp += 60 * 60 * 24;
-
-      int32_t offset = ESPTime::timezone_offset();
-      timestamp -= offset;  // to UTC
-      const uint32_t ms_left = (timestamp - timestamp_now) * 1000;
-      this->deep_sleep_->set_sleep_duration(ms_left);
     }
 #endif
     this->deep_sleep_->begin_sleep(true);
@@ -169,21 +479,53 @@ template<typename... Ts> class EnterDeepSleepAction : public Action<Ts...> {
  protected:
   DeepSleepComponent *deep_sleep_;
 #ifdef USE_TIME
-  optional<uint8_t> hour_;
-  optional<uint8_t> minute_;
-  optional<uint8_t> second_;
-  time::RealTimeClock *time_;
+  /// Seconds from `time` to the first slot strictly after it, wrapping to the next day.
+  uint32_t seconds_until_next_slot_(const ESPTime &time) const {
+    const uint32_t now = time.hour * 3600 + time.minute * 60 + time.second;
+    const uint32_t *end = this->schedule_ + this->schedule_size_;
+    const uint32_t *next = std::upper_bound(this->schedule_, end, now);
+    if (next == end)
+      return *this->schedule_ + 86400 - now;
+    return *next - now;
+  }
+
+  uint32_t until_{0};
+  const uint32_t *schedule_{nullptr};
+  size_t schedule_size_{0};
+  time::RealTimeClock *time_{nullptr};
 #endif
 };
 
 template<typename... Ts> class PreventDeepSleepAction : public Action<Ts...>, public Parented<DeepSleepComponent> {
  public:
-  void play(Ts... x) override { this->parent_->prevent_deep_sleep(); }
+  void set_holder(const std::string &holder) { this->holder_ = holder; }
+  void set_max_hold(uint32_t max_hold_ms) { this->max_hold_ms_ = max_hold_ms; }
+  void play(Ts... x) override {
+    if (this->holder_.empty()) {
+      this->parent_->prevent_deep_sleep();
+    } else {
+      this->parent_->prevent_deep_sleep(this->holder_, this->max_hold_ms_);
+    }
+  }
+
+ protected:
+  std::string holder_;
+  uint32_t max_hold_ms_{0};
 };
 
 template<typename... Ts> class AllowDeepSleepAction : public Action<Ts...>, public Parented<DeepSleepComponent> {
  public:
-  void play(Ts... x) override { this->parent_->allow_deep_sleep(); }
+  void set_holder(const std::string &holder) { this->holder_ = holder; }
+  void play(Ts... x) override {
+    if (this->holder_.empty()) {
+      this->parent_->allow_deep_sleep();
+    } else {
+      this->parent_->allow_deep_sleep(this->holder_);
+    }
+  }
+
+ protected:
+  std::string holder_;
 };
 
 }  // namespace deep_sleep
@@ -0,0 +1,127 @@
+import esphome.codegen as cg
+from esphome.components import sensor
+import esphome.config_validation as cv
+import esphome.final_validate as fv
+from esphome.const import (
+    DEVICE_CLASS_CURRENT,
+    DEVICE_CLASS_DURATION,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_MILLIAMP,
+    UNIT_MILLISECOND,
+    UNIT_SECOND,
+)
+
+from . import CONF_ADAPTIVE_SLEEP, DeepSleepComponent
+
+DEPENDENCIES = ["deep_sleep"]
+
+CONF_DEEP_SLEEP_ID = "deep_sleep_id"
+CONF_NEXT_SLEEP_DURATION = "next_sleep_duration"
+CONF_ENERGY_FLOOR = "energy_floor"
+CONF_AVERAGE_CURRENT = "average_current"
+CONF_WAKE_CAUSE = "wake_cause"
+CONF_BOOT_TIME = "boot_time"
+CONF_FIRST_PUBLISH_TIME = "first_publish_time"
+CONF_SHUTDOWN_TIME = "shutdown_time"
+CONF_AWAKE_TIME = "awake_time"
+CONF_REQUESTED_SLEEP = "requested_sleep"
+CONF_ACTUAL_SLEEP = "actual_sleep"
+CONF_DEFERRED_SLEEPS = "deferred_sleeps"
+
+# Sensors that need adaptive_sleep
+ADAPTIVE_SLEEP_SENSORS = (CONF_NEXT_SLEEP_DURATION, CONF_ENERGY_FLOOR, CONF_AVERAGE_CURRENT)
+
+DURATION_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_SECOND,
+    accuracy_decimals=0,
+    device_class=DEVICE_CLASS_DURATION,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+TIMING_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    accuracy_decimals=0,
+    device_class=DEVICE_CLASS_DURATION,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+# Wake-to-wake metrics: setter and schema. Timings are rolling averages,
+# sleep durations and deferred count are for the previous cycle.
+WAKE_METRIC_SENSORS = {
+    CONF_WAKE_CAUSE: (
+        "set_wake_cause_sensor",
+        sensor.sensor_schema(
+            icon="mdi:alarm",
+            accuracy_decimals=0,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    ),
+    CONF_BOOT_TIME: ("set_boot_time_sensor", TIMING_SCHEMA),
+    CONF_FIRST_PUBLISH_TIME: ("set_first_publish_time_sensor", TIMING_SCHEMA),
+    CONF_SHUTDOWN_TIME: ("set_shutdown_time_sensor", TIMING_SCHEMA),
+    CONF_AWAKE_TIME: ("set_awake_time_sensor", TIMING_SCHEMA),
+    CONF_REQUESTED_SLEEP: ("set_requested_sleep_sensor", DURATION_SCHEMA),
+    CONF_ACTUAL_SLEEP: (
+        "set_actual_sleep_sensor",
+        cv.All(cv.only_on_esp32, DURATION_SCHEMA),
+    ),
+    CONF_DEFERRED_SLEEPS: (
+        "set_deferred_sleeps_sensor",
+        sensor.sensor_schema(
+            icon="mdi:sleep-off",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    ),
+}
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_DEEP_SLEEP_ID): cv.use_id(DeepSleepComponent),
+        cv.Optional(CONF_NEXT_SLEEP_DURATION): DURATION_SCHEMA,
+        cv.Optional(CONF_ENERGY_FLOOR): DURATION_SCHEMA,
+        cv.Optional(CONF_AVERAGE_CURRENT): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLIAMP,
+            accuracy_decimals=2,
+            device_class=DEVICE_CLASS_CURRENT,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+).extend({cv.Optional(key): schema for key, (_, schema) in WAKE_METRIC_SENSORS.items()})
+
+
+def _final_validate(config):
+    full_config = fv.full_config.get()
+    deep_sleep_config = full_config.get("deep_sleep", {})
+    if CONF_ADAPTIVE_SLEEP not in deep_sleep_config and any(
+        key in config for key in ADAPTIVE_SLEEP_SENSORS
+    ):
+        raise cv.Invalid(
+            f"{', '.join(ADAPTIVE_SLEEP_SENSORS)} require adaptive_sleep to be configured"
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_DEEP_SLEEP_ID])
+    if CONF_NEXT_SLEEP_DURATION in config:
+        sens = await sensor.new_sensor(config[CONF_NEXT_SLEEP_DURATION])
+        cg.add(parent.set_next_sleep_duration_sensor(sens))
+    if CONF_ENERGY_FLOOR in config:
+        sens = await sensor.new_sensor(config[CONF_ENERGY_FLOOR])
+        cg.add(parent.set_energy_floor_sensor(sens))
+    if CONF_AVERAGE_CURRENT in config:
+        sens = await sensor.new_sensor(config[CONF_AVERAGE_CURRENT])
+        cg.add(parent.set_average_current_sensor(sens))
+    for key, (setter, _) in WAKE_METRIC_SENSORS.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(parent, setter)(sens))
@@ -0,0 +1,38 @@
+import esphome.codegen as cg
+from esphome.components import text_sensor
+import esphome.config_validation as cv
+from esphome.const import ENTITY_CATEGORY_DIAGNOSTIC
+
+from . import DeepSleepComponent
+
+DEPENDENCIES = ["deep_sleep"]
+
+CONF_DEEP_SLEEP_ID = "deep_sleep_id"
+CONF_INHIBITORS = "inhibitors"
+CONF_SHUTDOWN_REPORT = "shutdown_report"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_DEEP_SLEEP_ID): cv.use_id(DeepSleepComponent),
+        # Active sleep inhibitors with their count and hold time, empty when none
+        cv.Optional(CONF_INHIBITORS): text_sensor.text_sensor_schema(
+            icon="mdi:sleep-off",
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Total and slowest shutdown hooks of the previous sleep, needs `shutdown:` in deep_sleep
+        cv.Optional(CONF_SHUTDOWN_REPORT): text_sensor.text_sensor_schema(
+            icon="mdi:timer-sand",
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_DEEP_SLEEP_ID])
+    if CONF_INHIBITORS in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_INHIBITORS])
+        cg.add(parent.set_inhibitors_text_sensor(sens))
+    if CONF_SHUTDOWN_REPORT in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_SHUTDOWN_REPORT])
+        cg.add(parent.set_shutdown_report_text_sensor(sens))
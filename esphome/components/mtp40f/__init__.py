@@ -1,17 +1,39 @@
-import esphome.codegen as cg
-import esphome.config_validation as cv
-from esphome.const import CONF_ID
-
-CODEOWNERS = ["@plplaaa2"] # 당신의 깃허브 사용자 이름으로 변경하세요.
-
-mtp40f_ns = cg.esphome_ns.namespace("mtp40f")
-MTP40FComponent = mtp40f_ns.class_("MTP40FComponent", cg.PollingComponent, cg.Component)
-
-# 액션 클래스 참조 (mtp40f.h에 정의된 액션 클래스들과 일치해야 합니다)
-MTP40FEnableSelfCalibrationAction = mtp40f_ns.class_("MTP40FEnableSelfCalibrationAction")
-MTP40FDisableSelfCalibrationAction = mtp40f_ns.class_("MTP40FDisableSelfCalibrationAction")
-
-# 아직 C++ 파일에 구현되지 않은 액션들은 필요 시 주석 처리하거나, C++ 구현 후 추가합니다.
-# MTP40FSetAirPressureReferenceAction = mtp40f_ns.class_("MTP40FSetAirPressureReferenceAction")
-# MTP40FSetSelfCalibrationHoursAction = mtp40f_ns.class_("MTP40FSetSelfCalibrationHoursAction")
-# MTP40FPerformSinglePointCorrectionAction = mtp40f_ns.class_("MTP40FPerformSinglePointCorrectionAction")
+from esphome import pins
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.const import CONF_ID
+
+CODEOWNERS = ["@plplaaa2"] # 당신의 깃허브 사용자 이름으로 변경하세요.
+MULTI_CONF = True
+
+CONF_SELECT_PINS = "select_pins"
+
+mtp40f_ns = cg.esphome_ns.namespace("mtp40f")
+MTP40FComponent = mtp40f_ns.class_("MTP40FComponent", cg.PollingComponent, cg.Component)
+MTP40FBus = mtp40f_ns.class_("MTP40FBus", cg.PollingComponent)
+
+# 액션 클래스 참조 (mtp40f.h에 정의된 액션 클래스들과 일치해야 합니다)
+MTP40FEnableSelfCalibrationAction = mtp40f_ns.class_("MTP40FEnableSelfCalibrationAction")
+MTP40FDisableSelfCalibrationAction = mtp40f_ns.class_("MTP40FDisableSelfCalibrationAction")
+
+# 아직 C++ 파일에 구현되지 않은 액션들은 필요 시 주석 처리하거나, C++ 구현 후 추가합니다.
+# MTP40FSetAirPressureReferenceAction = mtp40f_ns.class_("MTP40FSetAirPressureReferenceAction")
+# MTP40FSetSelfCalibrationHoursAction = mtp40f_ns.class_("MTP40FSetSelfCalibrationHoursAction")
+# MTP40FPerformSinglePointCorrectionAction = mtp40f_ns.class_("MTP40FPerformSinglePointCorrectionAction")
+
+# === 여러 센서를 묶는 버스 (mtp40f:) ===
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(MTP40FBus),
+        cv.Optional(CONF_SELECT_PINS): cv.ensure_list(pins.gpio_output_pin_schema),
+    }
+).extend(cv.polling_component_schema("60s"))
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    for pin_config in config.get(CONF_SELECT_PINS, []):
+        pin = await cg.gpio_pin_expression(pin_config)
+        cg.add(var.add_select_pin(pin))
@@ -1,44 +1,149 @@
 #include "mtp40f.h"
+#include "mtp40f_bus.h"
 #include "esphome/core/log.h"
 #include "esphome/core/helpers.h"
 
+#include <cmath>
+
+#ifdef USE_ESP32
+#include <esp_attr.h>
+#include <esp_system.h>
+#endif
+#ifdef USE_ESP8266
+#include <Esp.h>
+#endif
+
 namespace esphome {
 namespace mtp40f {
 
 static const char *const TAG = "mtp40f";
 
-// 명령어 정의 (CRC는 동적으로 계산)
-static const uint8_t MTP40F_COMMAND_GET_PPM[] = {0x42, 0x4D, 0xA0, 0x00, 0x03, 0x00, 0x00, 0x01, 0x32}; // 9
+// 명령 프레임과 응답 길이는 mtp40f_protocol.h에서 컴파일 시간에 생성됨
 
-uint16_t MTP40FComponent::mtp40f_checksum_(const uint8_t *data, uint16_t length) {
-  uint16_t sum = 0;
-  for (uint16_t i = 0; i < length; i++) {
-    sum += data[i];
-  }
-  return sum;
+#ifdef USE_ESP32
+// 딥슬립 동안 유지되는 RTC 메모리 (전원 재인가 시 내용은 무효, crc로 확인)
+static RTC_NOINIT_ATTR MTP40FRetainedState mtp40f_retained[MTP40F_MAX_RETAINED_INSTANCES];
+#endif
+static uint8_t mtp40f_instance_count = 0;
+
+static uint16_t retained_crc(const MTP40FRetainedState &state) {
+  return crc16(reinterpret_cast<const uint8_t *>(&state), offsetof(MTP40FRetainedState, crc));
+}
+
+// 딥슬립에서 깨어났는지 확인. 그 외 리셋은 센서 전원도 끊겼다고 봄
+static bool woke_from_deep_sleep() {
+#if defined(USE_ESP32)
+  return esp_reset_reason() == ESP_RST_DEEPSLEEP;
+#elif defined(USE_ESP8266)
+  return ESP.getResetInfoPtr()->reason == REASON_DEEP_SLEEP_AWAKE;
+#else
+  return false;
+#endif
+}
+
+void MTP40FComponent::restore_retained_state_() {
+  this->retained_index_ = mtp40f_instance_count++;
+  if (!this->power_during_sleep_ || this->retained_index_ >= MTP40F_MAX_RETAINED_INSTANCES)
+    return;
+
+  MTP40FRetainedState state{};
+  bool loaded = false;
+#if defined(USE_ESP32)
+  state = mtp40f_retained[this->retained_index_];
+  loaded = true;
+#elif defined(USE_ESP8266)
+  // in_flash=false 이면 RTC user memory에 저장됨
+  this->retained_pref_ =
+      global_preferences->make_preference<MTP40FRetainedState>(fnv1_hash("mtp40f") + this->retained_index_, false);
+  loaded = this->retained_pref_.load(&state);
+#endif
+  if (!loaded || !woke_from_deep_sleep() || state.magic != MTP40F_RETAINED_MAGIC || state.crc != retained_crc(state))
+    return;
+
+  // 센서는 슬립 동안에도 켜져 있었으므로 이미 지난 예열 시간을 인정
+  uint32_t warmup_ms = this->warmup_seconds_ * 1000;
+  uint32_t credit_ms = state.warmed ? warmup_ms : std::min(state.powered_ms, warmup_ms);
+  this->last_update_time_ = millis() - credit_ms;
+  this->last_valid_ppm_ = state.last_ppm;
+  ESP_LOGD(TAG, "Restored warm-up state: %u ms powered%s, last CO2=%u ppm", state.powered_ms,
+           state.warmed ? " (warmed up)" : "", state.last_ppm);
 }
 
+void MTP40FComponent::save_retained_state_() {
+  if (!this->power_during_sleep_ || this->retained_index_ >= MTP40F_MAX_RETAINED_INSTANCES)
+    return;
+  MTP40FRetainedState state{};
+  state.magic = MTP40F_RETAINED_MAGIC;
+  state.powered_ms = millis() - this->last_update_time_;
+  state.last_ppm = this->last_valid_ppm_;
+  state.warmed = this->ready_ || state.powered_ms >= this->warmup_seconds_ * 1000;
+  state.crc = retained_crc(state);
+#if defined(USE_ESP32)
+  mtp40f_retained[this->retained_index_] = state;
+#elif defined(USE_ESP8266)
+  this->retained_pref_.save(&state);
+#endif
+}
+
+void MTP40FComponent::on_shutdown() { this->save_retained_state_(); }
+
+uint16_t MTP40FComponent::mtp40f_checksum_(const uint8_t *data, uint16_t length) { return mtp40f_sum(data, length); }
+
 void MTP40FComponent::setup() {
   ESP_LOGCONFIG(TAG, "Setting up MTP40F...");
   this->last_update_time_ = millis();
   this->last_error_ = MTP40F_OK;
+  this->restore_retained_state_();
+  if (this->power_pin_ != nullptr) {
+    this->power_pin_->setup();
+    this->power_pin_->digital_write(true);
+  }
+
+  // 준비될 때까지 update_interval과 관계없이 짧은 주기로 측정
+  if (this->readiness_samples_ != 0)
+    this->set_interval("readiness", this->readiness_interval_, [this]() { this->update_(); });
 
   // 부팅시 자동 self calibration 설정
-  if (self_calibration_) {
-    this->enable_self_calibration();
-  } else {
-    this->disable_self_calibration();
-  }
+  this->pending_self_calibration_ = this->self_calibration_;
+  this->send_setup_commands_();
+}
+
+void MTP40FComponent::send_setup_commands_() {
+  // 스위치로 바뀐 값이 있으면 그 값을 다시 적용
+  this->enqueue_command_(MTP40F_COMMAND_SET_SELF_CALIBRATION);
+#ifdef USE_MTP40F_EXTERNAL_AIR_PRESSURE
+  if (this->pending_air_pressure_reference_ != 0)
+    this->enqueue_command_(MTP40F_COMMAND_WRITE_AIR_PRESSURE_REFERENCE);
+#endif
 }
 
 void MTP40FComponent::update() {
+  // 진단 센서 발행 시간은 측정에서 제외
+  this->publish_metrics_();
+  uint32_t start_us = micros();
+  this->update_();
+  this->metrics_.record_loop_time(micros() - start_us);
+}
+
+void MTP40FComponent::update_() {
+  // 링크 장애 중에는 백오프가 끝날 때까지 요청하지 않음
+  if (this->in_backoff_())
+    return;
+
   uint32_t now_ms = millis();
   uint32_t warmup_ms = this->warmup_seconds_ * 1000;
 
-  if (now_ms - this->last_update_time_ < warmup_ms) {
-    ESP_LOGW(TAG, "MTP40F warming up, %u seconds left", (warmup_ms - (now_ms - this->last_update_time_)) / 1000);
-    this->status_set_warning();
-    return;
+  if (!this->ready_) {
+    if (now_ms - this->last_update_time_ >= warmup_ms) {
+      this->mark_ready_("warm-up time elapsed");
+    } else if (this->readiness_samples_ == 0) {
+      ESP_LOGW(TAG, "MTP40F warming up, %u seconds left", (warmup_ms - (now_ms - this->last_update_time_)) / 1000);
+      this->status_set_warning();
+      return;
+    } else {
+      // 수렴 판정 중에는 읽기만 하고 발행하지 않음
+      this->status_set_warning();
+    }
   }
 
   // 너무 빠른 읽기 방지(2초)
@@ -47,51 +152,546 @@ void MTP40FComponent::update() {
   }
   this->last_read_millis_ = now_ms;
 
+  // CO2 값 읽기 (응답은 loop()에서 처리)
+  this->enqueue_command_(MTP40F_COMMAND_READ_CO2);
+}
+
+// CO2 값 읽기 요청 전송
+void MTP40FComponent::request_co2_() {
   this->last_error_ = MTP40F_OK;
+  auto on_response = [this](bool success, const MTP40FFrameView &frame) { this->handle_co2_response_(success, frame); };
+  if (!this->send_command_<MTP40FGetGasConcentration>(MTP40FGetGasConcentration::FRAME, on_response)) {
+    ESP_LOGW(TAG, "Failed to read CO2 data from MTP40F! Last error: 0x%04X", this->last_error_);
+    this->status_set_warning();
+  }
+}
 
-  // CO2 값 읽기
-  if (!this->mtp40f_request_(MTP40F_COMMAND_GET_PPM, sizeof(MTP40F_COMMAND_GET_PPM), this->response_buffer_, 14)) {
+void MTP40FComponent::handle_co2_response_(bool success, const MTP40FFrameView &frame) {
+  if (!success) {
     ESP_LOGW(TAG, "Failed to read CO2 data from MTP40F! Last error: 0x%04X", this->last_error_);
     this->status_set_warning();
     return;
   }
 
   // CO2 파싱
-  uint32_t ppm_value = (this->response_buffer_[7] << 24) | (this->response_buffer_[8] << 16) | (this->response_buffer_[9] << 8) | this->response_buffer_[10];
-  uint8_t status_byte = this->response_buffer_[11];
+  auto response = MTP40FGetGasConcentration::decode(frame);
+  uint32_t ppm_value = response.ppm;
+  uint8_t status_byte = response.status;
+
+  if (!this->ready_) {
+    if (status_byte != 0x00) {
+      // 예열 중에는 흔한 응답이므로 오류로 세지 않음
+      ESP_LOGD(TAG, "MTP40F not ready, status 0x%02X", status_byte);
+      this->stable_samples_ = 0;
+      return;
+    }
+    if (this->readiness_samples_ == 0) {
+      // 고정 예열만 쓰면 예열 중에는 읽기를 보내지 않으므로, 이 응답은 전원 재인가 전에 보낸 요청의 것
+      if (millis() - this->last_update_time_ < this->warmup_seconds_ * 1000) {
+        ESP_LOGD(TAG, "MTP40F warming up, dropping CO2=%u ppm", ppm_value);
+        return;
+      }
+      this->mark_ready_("warm-up time elapsed");
+    } else if (!this->check_converged_(ppm_value)) {
+      return;
+    }
+  }
 
   if (status_byte == 0x00) {
     ESP_LOGD(TAG, "MTP40F Received CO2=%u ppm", ppm_value);
-    if (this->co2_sensor_ != nullptr) {
+#ifdef USE_MTP40F_TRACE
+    this->trace_dumped_ = false;
+#endif
+    this->last_valid_ppm_ = ppm_value;
+    this->save_retained_state_();
+    if (this->co2_sensor_ != nullptr && this->co2_deadband_.should_publish(ppm_value, millis())) {
       this->co2_sensor_->publish_state(ppm_value);
     }
+    if (this->has_aggregate_sensors_() && this->aggregator_.add_sample(ppm_value)) {
+      this->publish_aggregates_();
+    }
+    this->adapt_update_interval_(ppm_value);
     this->status_clear_warning();
   } else {
     this->last_error_ = MTP40F_INVALID_GAS_LEVEL;
+    this->metrics_.record_invalid_gas(MTP40FGetGasConcentration::OPCODE);
+#ifdef USE_MTP40F_TRACE
+    this->trace_.record(MTP40F_TRACE_ERROR, frame, MTP40F_INVALID_GAS_LEVEL);
+    this->trace_error_dump_();
+#endif
     ESP_LOGW(TAG, "MTP40F returned invalid gas level status: 0x%02X", status_byte);
     this->status_set_warning();
     return;
   }
 
-  // 대기압 참조값 읽기 (동적 CRC)
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+  // 대기압 참조값 읽기는 CO2 응답 이후에 이어서 요청. 캐시가 유효하면 읽기 생략
   if (this->air_pressure_reference_sensor_ != nullptr) {
-    this->last_error_ = MTP40F_OK;
-    uint8_t cmd[9] = {0x42, 0x4D, 0xA0, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00};
-    uint16_t checksum = 0;
-    for (int i = 0; i < 7; i++) checksum += cmd[i];
-    cmd[7] = checksum >> 8;
-    cmd[8] = checksum & 0xFF;
-    ESP_LOGD(TAG, "Sending Air Pressure Reference command: %02X %02X ... %02X %02X", cmd[0], cmd[1], cmd[7], cmd[8]);
-    if (!this->mtp40f_request_(cmd, 9, this->response_buffer_, 11)) {
-      ESP_LOGW(TAG, "Failed to read Air Pressure Reference from MTP40F! Last error: 0x%04X", this->last_error_);
+    if (this->device_air_pressure_reference_.has_value() &&
+        millis() - this->device_air_pressure_reference_time_ < this->air_pressure_reference_refresh_ms_) {
+      this->publish_air_pressure_reference_(*this->device_air_pressure_reference_);
     } else {
-      uint16_t air_pressure_ref = (this->response_buffer_[7] << 8) | this->response_buffer_[8];
-      ESP_LOGD(TAG, "MTP40F Received Air Pressure Reference=%u hPa", air_pressure_ref);
-      this->air_pressure_reference_sensor_->publish_state(air_pressure_ref);
+      this->enqueue_command_(MTP40F_COMMAND_READ_AIR_PRESSURE_REFERENCE);
+    }
+  }
+#endif
+}
+
+// 연속 측정값의 차이가 tolerance 이하로 samples번 이어지면 준비 완료
+bool MTP40FComponent::check_converged_(uint32_t ppm) {
+  uint32_t diff = ppm > this->readiness_last_ppm_ ? ppm - this->readiness_last_ppm_ : this->readiness_last_ppm_ - ppm;
+  if (this->stable_samples_ != 0 && diff <= this->readiness_tolerance_) {
+    this->stable_samples_++;
+  } else {
+    this->stable_samples_ = 1;
+  }
+  this->readiness_last_ppm_ = ppm;
+  ESP_LOGD(TAG, "MTP40F converging: CO2=%u ppm, %u/%u stable samples", ppm, this->stable_samples_,
+           this->readiness_samples_);
+  if (this->stable_samples_ < this->readiness_samples_)
+    return false;
+  this->mark_ready_("readings converged");
+  return true;
+}
+
+void MTP40FComponent::mark_ready_(const char *reason) {
+  this->ready_ = true;
+  this->cancel_interval("readiness");
+  ESP_LOGI(TAG, "MTP40F ready after %u ms (%s)", millis() - this->last_update_time_, reason);
+}
+
+// CO2 변화 속도에 따라 폴링 주기 조절. 빠르게 변하면 최소 주기로, 평탄하면 최대 주기까지 점차 늘림
+void MTP40FComponent::adapt_update_interval_(uint32_t ppm) {
+  uint32_t now = millis();
+  if (!this->adaptive_polling_ || this->bus_ != nullptr) {
+    return;
+  }
+  if (!this->adaptive_has_last_) {
+    this->adaptive_has_last_ = true;
+    this->adaptive_last_ppm_ = ppm;
+    this->adaptive_last_time_ = now;
+    this->publish_interval_();
+    return;
+  }
+
+  uint32_t elapsed_ms = std::max<uint32_t>(now - this->adaptive_last_time_, 1);
+  float slope = std::fabs(static_cast<float>(ppm) - static_cast<float>(this->adaptive_last_ppm_)) * 60000.0f /
+                elapsed_ms;  // ppm/min
+  this->adaptive_last_ppm_ = ppm;
+  this->adaptive_last_time_ = now;
+
+  uint32_t interval = this->get_update_interval();
+  if (slope >= this->adaptive_slope_threshold_) {
+    interval = this->adaptive_min_interval_;
+  } else if (slope >= this->adaptive_slope_threshold_ / 2) {
+    interval /= 2;
+  } else if (slope < this->adaptive_slope_threshold_ / 4) {
+    interval += interval / 2;
+  }
+  interval = clamp(interval, this->adaptive_min_interval_, this->adaptive_max_interval_);
+  if (interval == this->get_update_interval()) {
+    return;
+  }
+
+  ESP_LOGD(TAG, "CO2 slope %.1f ppm/min, update interval %u ms", slope, interval);
+  this->set_update_interval(interval);
+  // 새 주기로 타이머 재시작. 다음 읽기는 새 주기 뒤
+  this->stop_poller();
+  this->start_poller();
+  this->publish_interval_();
+}
+
+void MTP40FComponent::publish_interval_() {
+  if (this->interval_sensor_ != nullptr)
+    this->interval_sensor_->publish_state(this->get_update_interval() / 1000.0f);
+}
+
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+void MTP40FComponent::publish_air_pressure_reference_(uint16_t hpa) {
+  if (this->air_pressure_reference_deadband_.should_publish(hpa, millis())) {
+    this->air_pressure_reference_sensor_->publish_state(hpa);
+  }
+}
+#endif
+
+#ifdef USE_MTP40F_PRESSURE_CACHE
+void MTP40FComponent::set_device_air_pressure_reference_(uint16_t hpa) {
+  this->device_air_pressure_reference_ = hpa;
+  this->device_air_pressure_reference_time_ = millis();
+}
+#endif
+
+// 변화량이 임계값을 넘거나 heartbeat 간격이 지났을 때만 발행
+bool MTP40FDeadband::should_publish(float value, uint32_t now) {
+  if (this->enabled_ && this->has_last_) {
+    bool heartbeat_due = this->heartbeat_ms_ != 0 && now - this->last_publish_ >= this->heartbeat_ms_;
+    float threshold = std::max(this->absolute_, this->relative_ * std::fabs(this->last_value_));
+    if (!heartbeat_due && std::fabs(value - this->last_value_) <= threshold)
+      return false;
+  }
+  this->has_last_ = true;
+  this->last_value_ = value;
+  this->last_publish_ = now;
+  return true;
+}
+
+void MTP40FDeadband::dump_config(const char *name) const {
+  if (!this->enabled_)
+    return;
+  ESP_LOGCONFIG(TAG, "  %s deadband: %.1f absolute, %.1f%% relative, heartbeat %u ms", name, this->absolute_,
+                this->relative_ * 100.0f, this->heartbeat_ms_);
+}
+
+bool MTP40FComponent::has_aggregate_sensors_() const {
+  return this->co2_mean_sensor_ != nullptr || this->co2_min_sensor_ != nullptr || this->co2_max_sensor_ != nullptr ||
+         this->co2_median_sensor_ != nullptr;
+}
+
+// 창이 가득 찰 때마다 집계값을 한 번만 발행
+void MTP40FComponent::publish_aggregates_() {
+  if (this->co2_mean_sensor_ != nullptr)
+    this->co2_mean_sensor_->publish_state(this->aggregator_.mean());
+  if (this->co2_min_sensor_ != nullptr)
+    this->co2_min_sensor_->publish_state(this->aggregator_.min());
+  if (this->co2_max_sensor_ != nullptr)
+    this->co2_max_sensor_->publish_state(this->aggregator_.max());
+  if (this->co2_median_sensor_ != nullptr)
+    this->co2_median_sensor_->publish_state(this->aggregator_.median());
+  this->aggregator_.reset();
+}
+
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+// 대기압 참조값 읽기 (동적 CRC)
+void MTP40FComponent::request_air_pressure_reference_() {
+  this->last_error_ = MTP40F_OK;
+  ESP_LOGD(TAG, "Sending Air Pressure Reference command");
+  auto on_response = [this](bool success, const MTP40FFrameView &frame) {
+    this->handle_air_pressure_reference_response_(success, frame);
+  };
+  if (!this->send_command_<MTP40FGetAirPressureReference>(MTP40FGetAirPressureReference::FRAME, on_response)) {
+    ESP_LOGW(TAG, "Failed to read Air Pressure Reference from MTP40F! Last error: 0x%04X", this->last_error_);
+  }
+}
+
+void MTP40FComponent::handle_air_pressure_reference_response_(bool success, const MTP40FFrameView &frame) {
+  if (!success) {
+    ESP_LOGW(TAG, "Failed to read Air Pressure Reference from MTP40F! Last error: 0x%04X", this->last_error_);
+    return;
+  }
+  uint16_t air_pressure_ref = MTP40FGetAirPressureReference::decode(frame);
+  ESP_LOGD(TAG, "MTP40F Received Air Pressure Reference=%u hPa", air_pressure_ref);
+  this->set_device_air_pressure_reference_(air_pressure_ref);
+  this->publish_air_pressure_reference_(air_pressure_ref);
+}
+#endif
+
+// 값이 바뀐 경우에만 발행
+static void publish_if_changed(sensor::Sensor *sensor, float value) {
+  if (sensor != nullptr && (!sensor->has_state() || sensor->get_raw_state() != value))
+    sensor->publish_state(value);
+}
+
+// 진단 센서 발행 (설정된 것만)
+void MTP40FComponent::publish_metrics_() {
+  publish_if_changed(this->timeout_count_sensor_, this->metrics_.total_timeouts());
+  publish_if_changed(this->crc_error_count_sensor_, this->metrics_.total_crc_errors());
+  publish_if_changed(this->invalid_gas_count_sensor_, this->metrics_.total_invalid_gas());
+  if (this->metrics_.total_success() != 0)
+    publish_if_changed(this->round_trip_time_sensor_, this->metrics_.get_last_rtt_ms());
+  if (this->loop_time_sensor_ != nullptr)
+    publish_if_changed(this->loop_time_sensor_, this->metrics_.take_max_loop_time_us());
+}
+
+void MTP40FComponent::loop() {
+  // 할 일이 없거나 백오프 중이면 시간 측정도 생략
+  if (this->request_state_ == MTP40F_REQUEST_IDLE && (this->pending_commands_ == 0 || this->in_backoff_()))
+    return;
+  uint32_t start_us = micros();
+  this->loop_();
+  this->metrics_.record_loop_time(micros() - start_us);
+}
+
+void MTP40FComponent::loop_() {
+  if (this->request_state_ != MTP40F_REQUEST_WAITING) {
+    this->process_queue_();
+    return;
+  }
+
+  // 응답이 없는 명령은 전송 직후 완료
+  if (this->response_length_ == 0) {
+    this->finish_request_(true);
+    return;
+  }
+
+  MTP40FFrameView frame;
+  while (this->read_frame_(&frame)) {
+#ifdef USE_MTP40F_TRACE
+    this->trace_.record(MTP40F_TRACE_RX, frame);
+#endif
+    if (frame.command() != this->request_command_ || frame.size() != this->response_length_) {
+      ESP_LOGV(TAG, "Ignoring unexpected frame 0x%02X (%u bytes)", frame.command(), (unsigned) frame.size());
+      continue;
     }
+    // 잡음 뒤에 재동기화에 성공했으면 이전 체크섬 오류는 지움
+    this->last_error_ = MTP40F_OK;
+    this->finish_request_(true, frame);
+    return;
+  }
+
+  if (millis() - this->request_start_time_ > MTP40F_RESPONSE_TIMEOUT_MS) {
+    // 체크섬 오류가 있었다면 last_error_는 MTP40F_INVALID_CRC로 남음
+    if (this->last_error_ == MTP40F_OK) {
+      this->last_error_ = MTP40F_REQUEST_FAILED;
+      this->metrics_.record_timeout(this->request_command_);
+    }
+#ifdef USE_MTP40F_TRACE
+    this->trace_.record(MTP40F_TRACE_ERROR, &this->request_command_, 1, this->last_error_);
+#endif
+    ESP_LOGW(TAG, "MTP40F Read timeout! Expected %u bytes, %u bytes pending.", (unsigned) this->response_length_,
+             (unsigned) (this->rx_head_ - this->rx_tail_));
+    this->finish_request_(false);
+  }
+}
+
+void MTP40FComponent::finish_request_(bool success, const MTP40FFrameView &frame) {
+  this->request_state_ = MTP40F_REQUEST_IDLE;
+  if (this->bus_ != nullptr)
+    this->bus_->release(this);
+  uint32_t rtt_ms = millis() - this->request_start_time_;
+  ESP_LOGV(TAG, "Request 0x%02X %s after %u ms", this->request_command_, success ? "completed" : "failed", rtt_ms);
+  // 응답이 없는 명령은 왕복 시간이 없으므로 히스토그램에서 제외
+  if (success && this->response_length_ != 0) {
+    this->metrics_.record_success(this->request_command_, rtt_ms);
+    this->on_link_success_();
+  } else if (!success) {
+    this->on_link_failure_();
+  }
+  // callback 안에서 다음 요청을 보낼 수 있도록 먼저 상태를 비운 뒤 호출
+  ResponseCallback callback = std::move(this->request_callback_);
+  this->request_callback_ = nullptr;
+  if (callback) {
+    callback(success, frame);
+  }
+}
+
+void MTP40FComponent::on_link_success_() {
+  if (this->consecutive_failures_ != 0)
+    ESP_LOGI(TAG, "MTP40F link recovered after %u failed requests", this->consecutive_failures_);
+  this->consecutive_failures_ = 0;
+  this->backoff_ms_ = 0;
+}
+
+void MTP40FComponent::on_link_failure_() {
+  if (this->consecutive_failures_ < UINT8_MAX)
+    this->consecutive_failures_++;
+  // 체크섬 오류 뒤에는 남은 바이트를 버리고 다음 헤더부터 다시 맞춤
+  if (this->last_error_ == MTP40F_INVALID_CRC)
+    this->resync_rx_();
+
+  uint8_t shift = std::min<uint8_t>(this->consecutive_failures_ - 1, 8);
+  this->backoff_ms_ = std::min<uint32_t>(MTP40F_BACKOFF_BASE_MS << shift, MTP40F_BACKOFF_MAX_MS);
+  this->backoff_start_ = millis();
+  ESP_LOGW(TAG, "MTP40F request failed %u times in a row, next attempt in %u ms", this->consecutive_failures_,
+           this->backoff_ms_);
+
+#ifdef USE_MTP40F_TRACE
+  this->trace_error_dump_();
+#endif
+
+  if (this->power_pin_ != nullptr && this->consecutive_failures_ % this->power_cycle_after_ == 0)
+    this->power_cycle_();
+}
+
+#ifdef USE_MTP40F_TRACE
+// 유효한 측정값이 다시 들어올 때까지 한 번만 출력
+void MTP40FComponent::trace_error_dump_() {
+  if (!this->trace_dump_on_error_ || this->trace_dumped_)
+    return;
+  this->trace_dumped_ = true;
+  this->dump_trace();
+}
+#endif
+
+void MTP40FComponent::resync_rx_() {
+  ESP_LOGD(TAG, "Resyncing MTP40F frame stream, dropping %u bytes", (unsigned) (this->rx_head_ - this->rx_tail_));
+  this->drain_rx_();
+}
+
+void MTP40FComponent::power_cycle_() {
+  ESP_LOGW(TAG, "Power cycling MTP40F");
+  this->power_pin_->digital_write(false);
+  // 전원이 꺼져 있는 동안 요청하지 않음
+  this->backoff_ms_ = std::max(this->backoff_ms_, MTP40F_POWER_OFF_MS);
+  this->set_timeout("power_cycle", MTP40F_POWER_OFF_MS, [this]() {
+    this->power_pin_->digital_write(true);
+    this->on_power_restored_();
+  });
+}
+
+void MTP40FComponent::on_power_restored_() {
+  // 센서가 새로 켜졌으므로 예열과 설정을 처음부터 다시 수행.
+  // 실패 횟수와 백오프는 유효한 응답이 올 때만 초기화 (전원 재인가로 복구되지 않으면 계속 늘어남)
+  this->last_update_time_ = millis();
+  this->ready_ = false;
+  this->stable_samples_ = 0;
+#ifdef USE_MTP40F_PRESSURE_CACHE
+  this->device_air_pressure_reference_.reset();
+#endif
+  // 전원이 꺼지기 전에 대기 중이던 읽기와 진행 중이던 요청은 버림 (응답이 예열 판정을 건너뛰게 함)
+  this->pending_commands_ &= ~((1 << MTP40F_COMMAND_READ_CO2) | (1 << MTP40F_COMMAND_READ_AIR_PRESSURE_REFERENCE));
+  if (this->request_state_ != MTP40F_REQUEST_IDLE) {
+    ESP_LOGD(TAG, "Dropping request 0x%02X sent before the power cycle", this->request_command_);
+    this->request_state_ = MTP40F_REQUEST_IDLE;
+    this->request_callback_ = nullptr;
+    if (this->bus_ != nullptr)
+      this->bus_->release(this);
   }
-}  // ← 반드시 update 함수 끝에 이 중괄호!
+  this->drain_rx_();
+  if (this->readiness_samples_ != 0)
+    this->set_interval("readiness", this->readiness_interval_, [this]() { this->update_(); });
+  this->send_setup_commands_();
+}
 
+// UART에서 링 버퍼의 빈 공간만큼 한 번에 읽기
+void MTP40FComponent::fill_rx_buffer_() {
+  size_t available = this->available();
+  while (available > 0) {
+    size_t free = MTP40F_RX_BUFFER_SIZE - (this->rx_head_ - this->rx_tail_);
+    if (free == 0)
+      return;
+    size_t offset = this->rx_head_ & MTP40F_RX_BUFFER_MASK;
+    size_t chunk = std::min(std::min(free, MTP40F_RX_BUFFER_SIZE - offset), available);
+    if (!this->read_array(&this->rx_buffer_[offset], chunk))
+      return;
+    this->rx_head_ += chunk;
+    available -= chunk;
+  }
+}
+
+// 요청 전에 남아 있는 바이트를 모두 버림
+void MTP40FComponent::drain_rx_() {
+  do {
+    this->rx_tail_ = this->rx_head_;
+    this->fill_rx_buffer_();
+  } while (this->rx_head_ != this->rx_tail_);
+}
+
+uint16_t MTP40FComponent::rx_checksum_(size_t start, size_t length) {
+  // 합 체크섬이므로 링 버퍼 경계에서 두 구간으로 나눠 더해도 같음
+  size_t offset = start & MTP40F_RX_BUFFER_MASK;
+  size_t first = std::min(length, MTP40F_RX_BUFFER_SIZE - offset);
+  return this->mtp40f_checksum_(&this->rx_buffer_[offset], first) +
+         this->mtp40f_checksum_(this->rx_buffer_, length - first);
+}
+
+// 헤더(42 4D A0)를 찾아 완성된 프레임 하나를 반환. 잡음은 한 바이트씩 건너뛰며 재동기화
+bool MTP40FComponent::read_frame_(MTP40FFrameView *frame) {
+  this->fill_rx_buffer_();
+
+  while (this->rx_head_ - this->rx_tail_ >= sizeof(MTP40F_FRAME_HEADER)) {
+    MTP40FFrameView candidate(this->rx_buffer_, this->rx_tail_, this->rx_head_ - this->rx_tail_);
+    if (candidate[0] != MTP40F_FRAME_HEADER[0] || candidate[1] != MTP40F_FRAME_HEADER[1] ||
+        candidate[2] != MTP40F_FRAME_HEADER[2]) {
+      this->rx_tail_++;
+      continue;
+    }
+    if (candidate.size() < MTP40F_FRAME_HEADER_LENGTH)
+      return false;
+
+    uint16_t payload_length = candidate.payload_length();
+    if (payload_length > MTP40F_MAX_PAYLOAD_LENGTH) {
+      this->rx_tail_++;
+      continue;
+    }
+    size_t frame_length = MTP40F_FRAME_OVERHEAD + payload_length;
+    if (candidate.size() < frame_length)
+      return false;
+
+    uint16_t received_checksum = (candidate[frame_length - 2] << 8) | candidate[frame_length - 1];
+    uint16_t calculated_checksum = this->rx_checksum_(this->rx_tail_, frame_length - 2);
+    if (received_checksum != calculated_checksum) {
+      this->last_error_ = MTP40F_INVALID_CRC;
+      this->metrics_.record_crc_error(this->request_command_);
+#ifdef USE_MTP40F_TRACE
+      this->trace_.record(MTP40F_TRACE_ERROR, MTP40FFrameView(this->rx_buffer_, this->rx_tail_, frame_length),
+                          MTP40F_INVALID_CRC);
+#endif
+      ESP_LOGW(TAG, "MTP40F Response checksum mismatch! Received 0x%04X, calculated 0x%04X", received_checksum,
+               calculated_checksum);
+      this->rx_tail_++;
+      continue;
+    }
+
+    *frame = MTP40FFrameView(this->rx_buffer_, this->rx_tail_, frame_length);
+    this->rx_tail_ += frame_length;
+    return true;
+  }
+  return false;
+}
+
+// 명령 큐. 종류별로 한 칸만 두어 같은 명령은 최신 값으로 합쳐짐
+void MTP40FComponent::enqueue_command_(MTP40FCommandType type) { this->pending_commands_ |= 1 << type; }
+
+void MTP40FComponent::process_queue_() {
+  // 백오프 중에는 명령을 큐에 남겨 두었다가 복구 뒤 전송
+  if (this->pending_commands_ == 0 || this->in_backoff_())
+    return;
+  // 버스에 묶여 있으면 같은 UART의 다른 센서 요청이 끝날 때까지 대기
+  if (this->bus_ != nullptr && !this->bus_->acquire(this))
+    return;
+
+  while (this->pending_commands_ != 0) {
+    // 가장 낮은 비트 = 가장 높은 우선순위
+    MTP40FCommandType type = MTP40F_COMMAND_READ_CO2;
+    while ((this->pending_commands_ & (1 << type)) == 0)
+      type = static_cast<MTP40FCommandType>(type + 1);
+    this->pending_commands_ &= ~(1 << type);
+
+    switch (type) {
+      case MTP40F_COMMAND_READ_CO2:
+        this->request_co2_();
+        break;
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+      case MTP40F_COMMAND_READ_AIR_PRESSURE_REFERENCE:
+        this->request_air_pressure_reference_();
+        break;
+#endif
+#ifdef USE_MTP40F_EXTERNAL_AIR_PRESSURE
+      case MTP40F_COMMAND_WRITE_AIR_PRESSURE_REFERENCE:
+        // 센서가 이미 같은 값을 갖고 있으면 전송 생략
+        if (this->device_air_pressure_reference_.has_value() &&
+            *this->device_air_pressure_reference_ == this->pending_air_pressure_reference_) {
+          ESP_LOGV(TAG, "Air Pressure Reference already %u hPa, skipping write", this->pending_air_pressure_reference_);
+          continue;
+        }
+        this->request_write_air_pressure_reference_(this->pending_air_pressure_reference_);
+        break;
+#endif
+      case MTP40F_COMMAND_SET_SELF_CALIBRATION:
+        this->request_self_calibration_(this->pending_self_calibration_);
+        break;
+#ifdef USE_MTP40F_SELF_CALIBRATION_SWITCH
+      case MTP40F_COMMAND_READ_SELF_CALIBRATION:
+        this->request_self_calibration_status_();
+        break;
+#endif
+#ifdef USE_MTP40F_CALIBRATION
+      case MTP40F_COMMAND_CALIBRATE_400PPM:
+        this->request_calibrate_400ppm_();
+        break;
+#endif
+      default:
+        break;
+    }
+    if (this->request_state_ != MTP40F_REQUEST_IDLE)
+      return;
+  }
+  // 보낸 명령이 없으면 버스를 바로 돌려줌
+  if (this->bus_ != nullptr)
+    this->bus_->release(this);
+}
+
+#ifdef USE_MTP40F_EXTERNAL_AIR_PRESSURE
 // 외부 기압값
 void MTP40FComponent::set_external_air_pressure_sensor(sensor::Sensor *sensor) {
   this->external_air_pressure_sensor_ = sensor;
@@ -115,121 +715,116 @@ void MTP40FComponent::set_air_pressure_reference(uint16_t hpa) {
     ESP_LOGW(TAG, "Pressure value %u hPa out of range (700-1100)", hpa);
     return;
   }
+  this->pending_air_pressure_reference_ = hpa;
+  this->enqueue_command_(MTP40F_COMMAND_WRITE_AIR_PRESSURE_REFERENCE);
+}
+
+void MTP40FComponent::request_write_air_pressure_reference_(uint16_t hpa) {
   ESP_LOGD(TAG, "Setting Air Pressure Reference to %u hPa", hpa);
 
-  uint8_t cmd[11] = {
-      0x42, 0x4D, 0xA0,
-      0x00, 0x01,        // Command
-      0x00, 0x02,        // Data length
-      static_cast<uint8_t>(hpa >> 8), static_cast<uint8_t>(hpa & 0xFF), // Pressure (big endian)
-      0x00, 0x00         // Checksum placeholder
+  // 응답을 기다리지 않음 (MTP40F_NO_RESPONSE)
+  auto on_response = [this, hpa](bool success, const MTP40FFrameView &frame) {
+    if (success) {
+      this->set_device_air_pressure_reference_(hpa);
+    }
   };
-  // Checksum of first 9 bytes
-  uint16_t crc = 0;
-  for (int i = 0; i < 9; i++) crc += cmd[i];
-  cmd[9] = crc >> 8;
-  cmd[10] = crc & 0xFF;
-
-  // 전송, 응답 길이는 데이터시트 참고(없으면 0)
-  this->mtp40f_request_(cmd, 11, this->response_buffer_, 0);
+  if (!this->send_command_<MTP40FSetAirPressureReference>(MTP40FSetAirPressureReference::build_for(hpa),
+                                                          on_response)) {
+    ESP_LOGW(TAG, "Failed to set Air Pressure Reference! Last error: 0x%04X", this->last_error_);
+  }
 }
+#endif
 
+#ifdef USE_MTP40F_CALIBRATION
 // 400ppm 보정(제로베이스)
-void MTP40FComponent::calibrate_400ppm() {
+void MTP40FComponent::calibrate_400ppm() { this->enqueue_command_(MTP40F_COMMAND_CALIBRATE_400PPM); }
+
+void MTP40FComponent::request_calibrate_400ppm_() {
   ESP_LOGD(TAG, "Calibrating MTP40F sensor to 400ppm (zero calibration, single point).");
   this->last_error_ = MTP40F_OK;
-  uint8_t cmd[13] = {0x42, 0x4D, 0xA0, 0x00, 0x04, 0x00, 0x04, 0x00, 0x00, 0x01, 0x90, 0x00, 0x00}; // 400ppm=0x0190
-  uint16_t crc = mtp40f_checksum_(cmd, 11);
-  cmd[11] = crc >> 8;
-  cmd[12] = crc & 0xFF;
-  if (!this->mtp40f_request_(cmd, 13, this->response_buffer_, 10)) {
+  auto on_response = [this](bool success, const MTP40FFrameView &frame) {
+    if (!success) {
+      ESP_LOGW(TAG, "Failed to calibrate 400ppm! Last error: 0x%04X", this->last_error_);
+    }
+  };
+  if (!this->send_command_<MTP40FSinglePointCorrection>(MTP40FSinglePointCorrection::FRAME_400PPM, on_response)) {
     ESP_LOGW(TAG, "Failed to calibrate 400ppm! Last error: 0x%04X", this->last_error_);
   }
 }
+#endif
 
+#ifdef USE_MTP40F_SELF_CALIBRATION_SWITCH
 // 자기보정 상태 읽기
-void MTP40FComponent::read_self_calibration_status() {
-  uint8_t cmd[9] = {0x42, 0x4D, 0xA0, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00};
-  uint16_t checksum = 0;
-  for (int i = 0; i < 7; i++) checksum += cmd[i];
-  cmd[7] = checksum >> 8;
-  cmd[8] = checksum & 0xFF;
-
-  uint8_t resp[10];
-  if (!this->mtp40f_request_(cmd, 9, resp, 10)) {
-    ESP_LOGW(TAG, "Failed to read self-calibration status!");
-    return;
-  }
+void MTP40FComponent::read_self_calibration_status() { this->enqueue_command_(MTP40F_COMMAND_READ_SELF_CALIBRATION); }
 
-  uint8_t sc_state = resp[7];
-  if (sc_state == 0x01) {
-    ESP_LOGI(TAG, "Self-calibration is ENABLED.");
-  } else if (sc_state == 0x00) {
-    ESP_LOGI(TAG, "Self-calibration is DISABLED.");
-  } else {
-    ESP_LOGW(TAG, "Unknown self-calibration state: 0x%02X", sc_state);
+void MTP40FComponent::request_self_calibration_status_() {
+  auto on_response = [this](bool success, const MTP40FFrameView &frame) {
+    if (!success) {
+      ESP_LOGW(TAG, "Failed to read self-calibration status!");
+      return;
+    }
+    uint8_t sc_state = MTP40FGetSelfCalibration::decode(frame);
+    if (sc_state == 0x01) {
+      ESP_LOGI(TAG, "Self-calibration is ENABLED.");
+    } else if (sc_state == 0x00) {
+      ESP_LOGI(TAG, "Self-calibration is DISABLED.");
+    } else {
+      ESP_LOGW(TAG, "Unknown self-calibration state: 0x%02X", sc_state);
+    }
+  };
+  if (!this->send_command_<MTP40FGetSelfCalibration>(MTP40FGetSelfCalibration::FRAME, on_response)) {
+    ESP_LOGW(TAG, "Failed to read self-calibration status!");
   }
 }
+#endif
 
 void MTP40FComponent::enable_self_calibration() {
-  ESP_LOGD(TAG, "Enabling self-calibration on MTP40F...");
-  this->last_error_ = MTP40F_OK;
-  uint8_t cmd[10] = {0x42, 0x4D, 0xA0, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00};
-  uint16_t crc = mtp40f_checksum_(cmd, 8);
-  cmd[8] = crc >> 8;
-  cmd[9] = crc & 0xFF;
-  if (!this->mtp40f_request_(cmd, 10, this->response_buffer_, 9)) {
-    ESP_LOGW(TAG, "Failed to enable self-calibration! Last error: 0x%04X", this->last_error_);
-  }
+  this->pending_self_calibration_ = true;
+  this->enqueue_command_(MTP40F_COMMAND_SET_SELF_CALIBRATION);
 }
 
 void MTP40FComponent::disable_self_calibration() {
-  ESP_LOGD(TAG, "Disabling self-calibration on MTP40F...");
+  this->pending_self_calibration_ = false;
+  this->enqueue_command_(MTP40F_COMMAND_SET_SELF_CALIBRATION);
+}
+
+void MTP40FComponent::request_self_calibration_(bool enabled) {
+  ESP_LOGD(TAG, "%s self-calibration on MTP40F...", enabled ? "Enabling" : "Disabling");
   this->last_error_ = MTP40F_OK;
-  uint8_t cmd[10] = {0x42, 0x4D, 0xA0, 0x00, 0x06, 0x00, 0x01, 0xFF, 0x00, 0x00};
-  uint16_t crc = mtp40f_checksum_(cmd, 8);
-  cmd[8] = crc >> 8;
-  cmd[9] = crc & 0xFF;
-  if (!this->mtp40f_request_(cmd, 10, this->response_buffer_, 9)) {
-    ESP_LOGW(TAG, "Failed to disable self-calibration! Last error: 0x%04X", this->last_error_);
+  auto on_response = [this, enabled](bool success, const MTP40FFrameView &frame) {
+    if (!success) {
+      ESP_LOGW(TAG, "Failed to %s self-calibration! Last error: 0x%04X", enabled ? "enable" : "disable", this->last_error_);
+    }
+  };
+  const auto &frame = enabled ? MTP40FSetSelfCalibration::FRAME_ENABLE : MTP40FSetSelfCalibration::FRAME_DISABLE;
+  if (!this->send_command_<MTP40FSetSelfCalibration>(frame, on_response)) {
+    ESP_LOGW(TAG, "Failed to %s self-calibration! Last error: 0x%04X", enabled ? "enable" : "disable", this->last_error_);
   }
 }
 
-bool MTP40FComponent::mtp40f_request_(const uint8_t *full_command, size_t full_command_length, uint8_t *response_buffer, size_t response_length) {
-  // UART RX 버퍼 플러시
-  while (this->available()) {
-    this->read();
+bool MTP40FComponent::mtp40f_request_(const uint8_t *full_command, size_t full_command_length, size_t response_length,
+                                      ResponseCallback &&callback) {
+  if (this->request_state_ != MTP40F_REQUEST_IDLE) {
+    this->last_error_ = MTP40F_REQUEST_FAILED;
+    ESP_LOGW(TAG, "MTP40F request 0x%02X rejected, another request is in progress", full_command[4]);
+    return false;
   }
 
-  // 명령 전송
-  this->write_array(full_command, full_command_length);
-  this->flush();
+  // 이전 응답의 잔여 바이트 제거
+  this->drain_rx_();
 
-  // 응답 읽기
-  uint32_t start_time = millis();
-  size_t bytes_read = 0;
-  while (bytes_read < response_length) {
-    if (millis() - start_time > 1000) {
-      this->last_error_ = MTP40F_REQUEST_FAILED;
-      ESP_LOGW(TAG, "MTP40F Read timeout! Expected %u bytes, got %u bytes.", response_length, bytes_read);
-      return false;
-    }
-    if (this->available()) {
-      response_buffer[bytes_read++] = this->read();
-    }
-    yield();
-  }
+  // 명령 전송. flush()는 TX 완료까지 블로킹하므로 호출하지 않음
+  this->write_array(full_command, full_command_length);
+#ifdef USE_MTP40F_TRACE
+  this->trace_.record(MTP40F_TRACE_TX, full_command, full_command_length);
+#endif
 
-  // 응답 CRC 체크
-  if (response_length >= 2) {
-    uint16_t received_checksum = (response_buffer[response_length - 2] << 8) | response_buffer[response_length - 1];
-    uint16_t calculated_response_checksum = mtp40f_checksum_(response_buffer, response_length - 2);
-    if (received_checksum != calculated_response_checksum) {
-      this->last_error_ = MTP40F_INVALID_CRC;
-      ESP_LOGW(TAG, "MTP40F Response checksum mismatch! Received 0x%04X, calculated 0x%04X", received_checksum, calculated_response_checksum);
-      return false;
-    }
-  }
+  this->last_error_ = MTP40F_OK;
+  this->request_command_ = full_command[4];
+  this->response_length_ = response_length;
+  this->request_start_time_ = millis();
+  this->request_callback_ = std::move(callback);
+  this->request_state_ = MTP40F_REQUEST_WAITING;
   return true;
 }
 
@@ -240,9 +835,49 @@ float MTP40FComponent::get_setup_priority() const {
 void MTP40FComponent::dump_config() {
   ESP_LOGCONFIG(TAG, "MTP40F:");
   LOG_SENSOR("  ", "CO2", this->co2_sensor_);
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
   LOG_SENSOR("  ", "Air Pressure Reference", this->air_pressure_reference_sensor_);
+  ESP_LOGCONFIG(TAG, "  Air Pressure Reference refresh: %u ms", this->air_pressure_reference_refresh_ms_);
+#endif
   ESP_LOGCONFIG(TAG, "  Self-calibration enabled: %s", YESNO(this->self_calibration_));
   ESP_LOGCONFIG(TAG, "  Warmup time: %u seconds", this->warmup_seconds_);
+  if (this->readiness_samples_ != 0) {
+    ESP_LOGCONFIG(TAG, "  Readiness: %u samples within %u ppm, every %u ms", this->readiness_samples_,
+                  this->readiness_tolerance_, this->readiness_interval_);
+  }
+  ESP_LOGCONFIG(TAG, "  Powered during deep sleep: %s", YESNO(this->power_during_sleep_));
+  if (this->power_pin_ != nullptr) {
+    LOG_PIN("  Power Pin: ", this->power_pin_);
+    ESP_LOGCONFIG(TAG, "  Power cycle after: %u failed requests", this->power_cycle_after_);
+  }
+  if (this->adaptive_polling_) {
+    ESP_LOGCONFIG(TAG, "  Adaptive polling: %u-%u ms, fast slope %.1f ppm/min%s", this->adaptive_min_interval_,
+                  this->adaptive_max_interval_, this->adaptive_slope_threshold_,
+                  this->bus_ != nullptr ? " (disabled, polled by bus)" : "");
+    LOG_SENSOR("  ", "Update Interval", this->interval_sensor_);
+  }
+  this->co2_deadband_.dump_config("CO2");
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+  this->air_pressure_reference_deadband_.dump_config("Air Pressure Reference");
+#endif
+  if (this->has_aggregate_sensors_()) {
+    ESP_LOGCONFIG(TAG, "  Aggregate window: %u samples, spike filter: %u", this->aggregator_.get_window_size(),
+                  this->aggregator_.get_spike_filter_size());
+    LOG_SENSOR("  ", "CO2 Mean", this->co2_mean_sensor_);
+    LOG_SENSOR("  ", "CO2 Min", this->co2_min_sensor_);
+    LOG_SENSOR("  ", "CO2 Max", this->co2_max_sensor_);
+    LOG_SENSOR("  ", "CO2 Median", this->co2_median_sensor_);
+  }
+  LOG_SENSOR("  ", "Timeout Count", this->timeout_count_sensor_);
+  LOG_SENSOR("  ", "CRC Error Count", this->crc_error_count_sensor_);
+  LOG_SENSOR("  ", "Invalid Gas Level Count", this->invalid_gas_count_sensor_);
+  LOG_SENSOR("  ", "Round Trip Time", this->round_trip_time_sensor_);
+  LOG_SENSOR("  ", "Loop Time", this->loop_time_sensor_);
+  this->metrics_.dump_config(TAG);
+#ifdef USE_MTP40F_TRACE
+  ESP_LOGCONFIG(TAG, "  Trace: %u frames, dump on error: %s", (unsigned) MTP40F_TRACE_SIZE,
+                YESNO(this->trace_dump_on_error_));
+#endif
 }
 
 }  // namespace mtp40f
@@ -1,88 +1,391 @@
-#pragma once
-
-#include "esphome/core/component.h"
-#include "esphome/components/uart/uart.h"
-#include "esphome/components/sensor/sensor.h"
-#include "esphome/components/switch/switch.h"
-
-namespace esphome {
-namespace mtp40f {
-
-#define MTP40F_OK                   0x00
-#define MTP40F_INVALID_AIR_PRESSURE 0x01
-#define MTP40F_INVALID_GAS_LEVEL    0x02
-#define MTP40F_INVALID_CRC          0x10
-#define MTP40F_NO_STREAM            0x20
-#define MTP40F_REQUEST_FAILED       0xFFFF
-
-class MTP40FComponent : public PollingComponent, public uart::UARTDevice {
- public:
-  void setup() override;
-  void update() override;
-  void dump_config() override;
-  float get_setup_priority() const override;
-
-  // 센서 설정
-  void set_co2_sensor(sensor::Sensor *co2_sensor) { co2_sensor_ = co2_sensor; }
-  void set_air_pressure_reference_sensor(sensor::Sensor *air_pressure_reference_sensor) { air_pressure_reference_sensor_ = air_pressure_reference_sensor; }
-  void set_air_pressure_reference(uint16_t hpa);
-
-  // Self calibration 및 400ppm 보정
-  void enable_self_calibration();
-  void disable_self_calibration();
-  void read_self_calibration_status(); 
-  void calibrate_400ppm();
-
-  // 파라미터
-  void set_self_calibration_enabled(bool enabled) { self_calibration_ = enabled; }
-  void set_warmup_seconds(uint32_t seconds) { warmup_seconds_ = seconds; }
-  void set_external_air_pressure_sensor(sensor::Sensor *sensor);
-  void on_external_air_pressure_update(float pressure_hpa);
-
-  // 디버깅
-  int get_last_error() { return last_error_; }
-
- protected:
-  uint16_t mtp40f_checksum_(const uint8_t *data, uint16_t length);
-  bool mtp40f_request_(const uint8_t *full_command, size_t full_command_length, uint8_t *response_buffer, size_t response_length);
-
-  sensor::Sensor *co2_sensor_{nullptr};
-  sensor::Sensor *air_pressure_reference_sensor_{nullptr};
-  sensor::Sensor *external_air_pressure_sensor_{nullptr};
-  bool self_calibration_{true};
-  uint32_t warmup_seconds_{60};
-  uint32_t last_update_time_{0};
-  uint32_t last_read_millis_{0};
-  int last_error_{MTP40F_OK};
-  uint8_t response_buffer_[20];
-};
-
-
-// Switch class for self calibration ON/OFF
-class MTP40FSelfCalibrationSwitch : public switch_::Switch, public Component {
- public:
-  void set_parent(MTP40FComponent *parent) { parent_ = parent; }
-  void write_state(bool state) override {
-    if (state) {
-      parent_->enable_self_calibration();
-    } else {
-      parent_->disable_self_calibration();
-    }
-    publish_state(state);
-  }
- protected:
-  MTP40FComponent *parent_;
-};
-
-// 액션 클래스 (자동화에서 사용할 때)
-template<typename... Ts>
-class MTP40FCalibrate400ppmAction : public Action<Ts...> {
- public:
-  MTP40FCalibrate400ppmAction(MTP40FComponent *parent) : parent_(parent) {}
-  void play(Ts... x) override { this->parent_->calibrate_400ppm(); }
- protected:
-  MTP40FComponent *parent_;
-};
-
-}  // namespace mtp40f
-}  // namespace esphome
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/uart/uart.h"
+#include "esphome/components/sensor/sensor.h"
+#ifdef USE_MTP40F_SELF_CALIBRATION_SWITCH
+#include "esphome/components/switch/switch.h"
+#endif
+#include "mtp40f_aggregate.h"
+#include "mtp40f_metrics.h"
+#include "mtp40f_protocol.h"
+#include "mtp40f_trace.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace esphome {
+namespace mtp40f {
+
+#define MTP40F_OK                   0x00
+#define MTP40F_INVALID_AIR_PRESSURE 0x01
+#define MTP40F_INVALID_GAS_LEVEL    0x02
+#define MTP40F_INVALID_CRC          0x10
+#define MTP40F_NO_STREAM            0x20
+#define MTP40F_REQUEST_FAILED       0xFFFF
+
+// 응답 대기 제한 시간
+static const uint32_t MTP40F_RESPONSE_TIMEOUT_MS = 1000;
+// 연속 실패 시 재시도 간격: 2s, 4s, 8s ... 최대 5분
+static const uint32_t MTP40F_BACKOFF_BASE_MS = 2000;
+static const uint32_t MTP40F_BACKOFF_MAX_MS = 300000;
+// 전원 재인가 시 꺼 두는 시간
+static const uint32_t MTP40F_POWER_OFF_MS = 1000;
+
+enum MTP40FRequestState : uint8_t {
+  MTP40F_REQUEST_IDLE = 0,
+  MTP40F_REQUEST_WAITING,
+};
+
+// 명령 종류. 값이 작을수록 우선순위가 높음
+enum MTP40FCommandType : uint8_t {
+  MTP40F_COMMAND_READ_CO2 = 0,
+  MTP40F_COMMAND_WRITE_AIR_PRESSURE_REFERENCE,
+  MTP40F_COMMAND_READ_AIR_PRESSURE_REFERENCE,
+  MTP40F_COMMAND_SET_SELF_CALIBRATION,
+  MTP40F_COMMAND_READ_SELF_CALIBRATION,
+  MTP40F_COMMAND_CALIBRATE_400PPM,
+  MTP40F_COMMAND_TYPE_COUNT,
+};
+static_assert(MTP40F_COMMAND_TYPE_COUNT <= 8, "pending command mask is 8 bits");
+
+class MTP40FBus;
+
+// 센서에 설정된 기압 참조값 캐시는 읽기와 쓰기 양쪽에서 사용
+#if defined(USE_MTP40F_AIR_PRESSURE_REFERENCE) || defined(USE_MTP40F_EXTERNAL_AIR_PRESSURE)
+#define USE_MTP40F_PRESSURE_CACHE
+#endif
+
+// 딥슬립 사이에 유지하는 예열 상태
+static const uint32_t MTP40F_RETAINED_MAGIC = 0x4D545046;  // "MTPF"
+static const uint8_t MTP40F_MAX_RETAINED_INSTANCES = 4;
+struct MTP40FRetainedState {
+  uint32_t magic;
+  uint32_t powered_ms;  // 센서 전원이 들어간 뒤 지난 시간
+  uint32_t last_ppm;    // 마지막 유효 측정값
+  uint8_t warmed;
+  uint8_t reserved;
+  uint16_t crc;
+};
+
+// 변화량 기준 발행 (send-on-delta). 설정하지 않으면 매번 발행
+class MTP40FDeadband {
+ public:
+  void set(float absolute, float relative, uint32_t heartbeat_ms) {
+    this->absolute_ = absolute;
+    this->relative_ = relative;
+    this->heartbeat_ms_ = heartbeat_ms;
+    this->enabled_ = true;
+  }
+  bool should_publish(float value, uint32_t now);
+  void dump_config(const char *name) const;
+
+ protected:
+  bool enabled_{false};
+  bool has_last_{false};
+  float absolute_{0.0f};
+  float relative_{0.0f};  // 0.02 = 2%
+  uint32_t heartbeat_ms_{0};
+  float last_value_{0.0f};
+  uint32_t last_publish_{0};
+};
+
+class MTP40FComponent : public PollingComponent, public uart::UARTDevice {
+ public:
+  void setup() override;
+  void on_shutdown() override;
+  void update() override;
+  void loop() override;
+  void dump_config() override;
+  float get_setup_priority() const override;
+
+  // 센서 설정
+  void set_co2_sensor(sensor::Sensor *co2_sensor) { co2_sensor_ = co2_sensor; }
+  void set_co2_deadband(float absolute, float relative, uint32_t heartbeat_ms) {
+    co2_deadband_.set(absolute, relative, heartbeat_ms);
+  }
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+  void set_air_pressure_reference_sensor(sensor::Sensor *air_pressure_reference_sensor) { air_pressure_reference_sensor_ = air_pressure_reference_sensor; }
+  void set_air_pressure_reference_deadband(float absolute, float relative, uint32_t heartbeat_ms) {
+    air_pressure_reference_deadband_.set(absolute, relative, heartbeat_ms);
+  }
+  void set_air_pressure_reference_refresh(uint32_t refresh_ms) { air_pressure_reference_refresh_ms_ = refresh_ms; }
+#endif
+#ifdef USE_MTP40F_EXTERNAL_AIR_PRESSURE
+  void set_air_pressure_reference(uint16_t hpa);
+  void set_external_air_pressure_sensor(sensor::Sensor *sensor);
+  void on_external_air_pressure_update(float pressure_hpa);
+#endif
+
+  // 창 단위 집계 센서 (선택)
+  void set_co2_mean_sensor(sensor::Sensor *sensor) { co2_mean_sensor_ = sensor; }
+  void set_co2_min_sensor(sensor::Sensor *sensor) { co2_min_sensor_ = sensor; }
+  void set_co2_max_sensor(sensor::Sensor *sensor) { co2_max_sensor_ = sensor; }
+  void set_co2_median_sensor(sensor::Sensor *sensor) { co2_median_sensor_ = sensor; }
+  void set_aggregate_window_size(uint8_t window_size) { aggregator_.set_window_size(window_size); }
+  void set_aggregate_spike_filter_size(uint8_t size) { aggregator_.set_spike_filter_size(size); }
+
+  // CO2 변화 속도에 따른 가변 폴링 (선택). 최소 주기는 2초 이상
+  void set_adaptive_polling(uint32_t min_interval_ms, uint32_t max_interval_ms, float slope_threshold) {
+    adaptive_polling_ = true;
+    adaptive_min_interval_ = std::max<uint32_t>(min_interval_ms, 2000);
+    adaptive_max_interval_ = std::max(max_interval_ms, adaptive_min_interval_);
+    adaptive_slope_threshold_ = slope_threshold;
+  }
+  void set_interval_sensor(sensor::Sensor *sensor) { interval_sensor_ = sensor; }
+
+  // 진단 센서 (선택)
+  void set_timeout_count_sensor(sensor::Sensor *sensor) { timeout_count_sensor_ = sensor; }
+  void set_crc_error_count_sensor(sensor::Sensor *sensor) { crc_error_count_sensor_ = sensor; }
+  void set_invalid_gas_count_sensor(sensor::Sensor *sensor) { invalid_gas_count_sensor_ = sensor; }
+  void set_round_trip_time_sensor(sensor::Sensor *sensor) { round_trip_time_sensor_ = sensor; }
+  void set_loop_time_sensor(sensor::Sensor *sensor) { loop_time_sensor_ = sensor; }
+  const MTP40FMetrics &get_metrics() const { return metrics_; }
+#ifdef USE_MTP40F_TRACE
+  // 최근 송수신 프레임 출력. dump_on_error면 오류 구간마다 한 번 자동 출력
+  void dump_trace() { trace_.dump("mtp40f"); }
+  void set_trace_dump_on_error(bool dump_on_error) { trace_dump_on_error_ = dump_on_error; }
+#endif
+
+  // Self calibration 및 400ppm 보정
+  void enable_self_calibration();
+  void disable_self_calibration();
+#ifdef USE_MTP40F_SELF_CALIBRATION_SWITCH
+  void read_self_calibration_status();
+#endif
+#ifdef USE_MTP40F_CALIBRATION
+  void calibrate_400ppm();
+#endif
+
+  // 파라미터
+  void set_self_calibration_enabled(bool enabled) { self_calibration_ = enabled; }
+  void set_warmup_seconds(uint32_t seconds) { warmup_seconds_ = seconds; }
+  // 예열 시간을 기다리지 않고 바로 읽되, 연속 측정값이 tolerance 안에 samples번 들어오면 준비 완료.
+  // warmup_time은 상한으로만 사용
+  void set_readiness(uint8_t samples, uint32_t tolerance_ppm, uint32_t interval_ms) {
+    readiness_samples_ = samples;
+    readiness_tolerance_ = tolerance_ppm;
+    readiness_interval_ = std::max<uint32_t>(interval_ms, 2000);
+  }
+  bool is_ready() const { return ready_; }
+  // 딥슬립 중에도 센서 전원이 유지되면 깨어난 뒤 예열을 생략
+  void set_power_during_sleep(bool power_during_sleep) { power_during_sleep_ = power_during_sleep; }
+  uint32_t get_last_valid_ppm() const { return last_valid_ppm_; }
+  void set_bus(MTP40FBus *bus) { bus_ = bus; }
+  // 센서 전원 제어 핀 (선택). 연속 실패가 power_cycle_after번 쌓이면 전원을 껐다 켬
+  void set_power_pin(GPIOPin *pin) { power_pin_ = pin; }
+  void set_power_cycle_after(uint8_t failures) { power_cycle_after_ = failures; }
+  bool is_link_up() const { return consecutive_failures_ == 0; }
+  uart::UARTComponent *get_uart_parent() const { return parent_; }
+
+  // 디버깅
+  int get_last_error() { return last_error_; }
+  bool is_busy() const { return request_state_ != MTP40F_REQUEST_IDLE || pending_commands_ != 0; }
+
+ protected:
+  using ResponseCallback = std::function<void(bool success, const MTP40FFrameView &frame)>;
+
+  // 시간 측정을 감싼 실제 update()/loop() 본문
+  void update_();
+  void loop_();
+  void publish_metrics_();
+
+  uint16_t mtp40f_checksum_(const uint8_t *data, uint16_t length);
+  // 수신 링 버퍼
+  void fill_rx_buffer_();
+  void drain_rx_();
+  bool read_frame_(MTP40FFrameView *frame);
+  uint16_t rx_checksum_(size_t start, size_t length);
+  // 명령을 전송하고 즉시 반환. 응답은 loop()에서 수집되어 callback으로 전달됨
+  bool mtp40f_request_(const uint8_t *full_command, size_t full_command_length, size_t response_length,
+                       ResponseCallback &&callback);
+  // 명령 정의에서 프레임 길이와 응답 길이를 가져와 전송
+  template<typename Command> bool send_command_(const typename Command::Frame &frame, ResponseCallback &&callback) {
+    return this->mtp40f_request_(frame.data, Command::REQUEST_LENGTH, Command::RESPONSE_LENGTH, std::move(callback));
+  }
+  void finish_request_(bool success, const MTP40FFrameView &frame = {});
+
+  // 링크 상태: 실패가 이어지면 지수 백오프 동안 요청을 보내지 않음
+  void on_link_success_();
+  void on_link_failure_();
+  bool in_backoff_() const { return backoff_ms_ != 0 && millis() - backoff_start_ < backoff_ms_; }
+  void resync_rx_();
+  void power_cycle_();
+  void on_power_restored_();
+  // 부팅 또는 전원 재인가 뒤 센서에 다시 보낼 설정
+  void send_setup_commands_();
+
+  // 명령 큐
+  void enqueue_command_(MTP40FCommandType type);
+  void process_queue_();
+
+  void request_co2_();
+  void handle_co2_response_(bool success, const MTP40FFrameView &frame);
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+  void request_air_pressure_reference_();
+  void handle_air_pressure_reference_response_(bool success, const MTP40FFrameView &frame);
+  void publish_air_pressure_reference_(uint16_t hpa);
+#endif
+#ifdef USE_MTP40F_PRESSURE_CACHE
+  void set_device_air_pressure_reference_(uint16_t hpa);
+#endif
+#ifdef USE_MTP40F_EXTERNAL_AIR_PRESSURE
+  void request_write_air_pressure_reference_(uint16_t hpa);
+#endif
+  void request_self_calibration_(bool enabled);
+#ifdef USE_MTP40F_SELF_CALIBRATION_SWITCH
+  void request_self_calibration_status_();
+#endif
+#ifdef USE_MTP40F_CALIBRATION
+  void request_calibrate_400ppm_();
+#endif
+
+  void mark_ready_(const char *reason);
+  bool check_converged_(uint32_t ppm);
+
+  void restore_retained_state_();
+  void save_retained_state_();
+
+  void adapt_update_interval_(uint32_t ppm);
+  void publish_interval_();
+
+  bool has_aggregate_sensors_() const;
+  void publish_aggregates_();
+
+  sensor::Sensor *co2_sensor_{nullptr};
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+  sensor::Sensor *air_pressure_reference_sensor_{nullptr};
+#endif
+#ifdef USE_MTP40F_EXTERNAL_AIR_PRESSURE
+  sensor::Sensor *external_air_pressure_sensor_{nullptr};
+#endif
+  MTP40FBus *bus_{nullptr};
+  GPIOPin *power_pin_{nullptr};
+  uint8_t power_cycle_after_{5};
+  uint8_t consecutive_failures_{0};
+  uint32_t backoff_start_{0};
+  uint32_t backoff_ms_{0};
+
+  MTP40FAggregator aggregator_;
+  sensor::Sensor *co2_mean_sensor_{nullptr};
+  sensor::Sensor *co2_min_sensor_{nullptr};
+  sensor::Sensor *co2_max_sensor_{nullptr};
+  sensor::Sensor *co2_median_sensor_{nullptr};
+  bool adaptive_polling_{false};
+  uint32_t adaptive_min_interval_{2000};
+  uint32_t adaptive_max_interval_{300000};
+  float adaptive_slope_threshold_{50.0f};  // ppm/min
+  bool adaptive_has_last_{false};
+  uint32_t adaptive_last_ppm_{0};
+  uint32_t adaptive_last_time_{0};
+  sensor::Sensor *interval_sensor_{nullptr};
+
+  MTP40FMetrics metrics_;
+#ifdef USE_MTP40F_TRACE
+  void trace_error_dump_();
+  MTP40FTrace trace_;
+  bool trace_dump_on_error_{false};
+  bool trace_dumped_{false};
+#endif
+  sensor::Sensor *timeout_count_sensor_{nullptr};
+  sensor::Sensor *crc_error_count_sensor_{nullptr};
+  sensor::Sensor *invalid_gas_count_sensor_{nullptr};
+  sensor::Sensor *round_trip_time_sensor_{nullptr};
+  sensor::Sensor *loop_time_sensor_{nullptr};
+
+  bool self_calibration_{true};
+  uint32_t warmup_seconds_{60};
+  bool ready_{false};
+  uint8_t readiness_samples_{0};  // 0 = 고정 예열 시간만 사용
+  uint32_t readiness_tolerance_{0};
+  uint32_t readiness_interval_{2000};
+  uint8_t stable_samples_{0};
+  uint32_t readiness_last_ppm_{0};
+  bool power_during_sleep_{false};
+  uint8_t retained_index_{0};
+  uint32_t last_valid_ppm_{0};
+#ifdef USE_ESP8266
+  ESPPreferenceObject retained_pref_;
+#endif
+  uint32_t last_update_time_{0};
+  uint32_t last_read_millis_{0};
+  int last_error_{MTP40F_OK};
+
+  uint8_t rx_buffer_[MTP40F_RX_BUFFER_SIZE];
+  size_t rx_head_{0};  // 쓰기 위치 (증가만 하고 마스크로 접근)
+  size_t rx_tail_{0};  // 파싱 위치
+
+  // 비동기 요청 상태
+  MTP40FRequestState request_state_{MTP40F_REQUEST_IDLE};
+  uint8_t request_command_{0};
+  size_t response_length_{0};
+  uint32_t request_start_time_{0};
+  ResponseCallback request_callback_;
+
+  // 대기 중인 명령 (MTP40FCommandType 비트마스크)와 합쳐진 인자
+  uint8_t pending_commands_{0};
+#ifdef USE_MTP40F_EXTERNAL_AIR_PRESSURE
+  uint16_t pending_air_pressure_reference_{0};
+#endif
+  bool pending_self_calibration_{true};
+#ifdef USE_MTP40F_PRESSURE_CACHE
+  // 센서에 설정된 것으로 확인된 기압 참조값
+  optional<uint16_t> device_air_pressure_reference_;
+  uint32_t device_air_pressure_reference_time_{0};
+#endif
+#ifdef USE_MTP40F_AIR_PRESSURE_REFERENCE
+  uint32_t air_pressure_reference_refresh_ms_{0};
+  MTP40FDeadband air_pressure_reference_deadband_;
+#endif
+
+  MTP40FDeadband co2_deadband_;
+};
+
+
+#ifdef USE_MTP40F_SELF_CALIBRATION_SWITCH
+// Switch class for self calibration ON/OFF
+class MTP40FSelfCalibrationSwitch : public switch_::Switch, public Component {
+ public:
+  void set_parent(MTP40FComponent *parent) { parent_ = parent; }
+  void write_state(bool state) override {
+    if (state) {
+      parent_->enable_self_calibration();
+    } else {
+      parent_->disable_self_calibration();
+    }
+    publish_state(state);
+  }
+ protected:
+  MTP40FComponent *parent_;
+};
+#endif
+
+#ifdef USE_MTP40F_TRACE
+template<typename... Ts> class MTP40FDumpTraceAction : public Action<Ts...> {
+ public:
+  MTP40FDumpTraceAction(MTP40FComponent *parent) : parent_(parent) {}
+  void play(Ts... x) override { this->parent_->dump_trace(); }
+
+ protected:
+  MTP40FComponent *parent_;
+};
+#endif
+
+#ifdef USE_MTP40F_CALIBRATION
+// 액션 클래스 (자동화에서 사용할 때)
+template<typename... Ts>
+class MTP40FCalibrate400ppmAction : public Action<Ts...> {
+ public:
+  MTP40FCalibrate400ppmAction(MTP40FComponent *parent) : parent_(parent) {}
+  void play(Ts... x) override { this->parent_->calibrate_400ppm(); }
+ protected:
+  MTP40FComponent *parent_;
+};
+#endif
+
+}  // namespace mtp40f
+}  // namespace esphome
@@ -0,0 +1,63 @@
+#include "mtp40f_aggregate.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace mtp40f {
+
+void MTP40FAggregator::set_window_size(uint8_t window_size) {
+  this->window_size_ = std::min<uint8_t>(std::max<uint8_t>(window_size, 1), MTP40F_AGGREGATE_MAX_WINDOW);
+  this->reset();
+}
+
+void MTP40FAggregator::set_spike_filter_size(uint8_t spike_filter_size) {
+  this->spike_filter_size_ = std::min<uint8_t>(std::max<uint8_t>(spike_filter_size, 1), MTP40F_SPIKE_FILTER_MAX);
+  this->recent_count_ = 0;
+  this->recent_index_ = 0;
+}
+
+bool MTP40FAggregator::add_sample(uint32_t ppm) {
+  uint16_t value = this->spike_filter_(std::min<uint32_t>(ppm, UINT16_MAX));
+  this->samples_[this->count_++] = value;
+  this->sum_ += value;
+  this->min_ = std::min(this->min_, value);
+  this->max_ = std::max(this->max_, value);
+  return this->count_ >= this->window_size_;
+}
+
+uint16_t MTP40FAggregator::median() {
+  uint16_t *middle = this->samples_ + this->count_ / 2;
+  std::nth_element(this->samples_, middle, this->samples_ + this->count_);
+  return *middle;
+}
+
+void MTP40FAggregator::reset() {
+  this->count_ = 0;
+  this->sum_ = 0;
+  this->min_ = UINT16_MAX;
+  this->max_ = 0;
+}
+
+uint16_t MTP40FAggregator::spike_filter_(uint16_t value) {
+  if (this->spike_filter_size_ <= 1)
+    return value;
+
+  this->recent_[this->recent_index_] = value;
+  this->recent_index_ = (this->recent_index_ + 1) % this->spike_filter_size_;
+  if (this->recent_count_ < this->spike_filter_size_)
+    this->recent_count_++;
+
+  // 최대 5개라 삽입 정렬로 충분
+  uint16_t sorted[MTP40F_SPIKE_FILTER_MAX];
+  for (uint8_t i = 0; i < this->recent_count_; i++) {
+    uint16_t v = this->recent_[i];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > v; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = v;
+  }
+  return sorted[this->recent_count_ / 2];
+}
+
+}  // namespace mtp40f
+}  // namespace esphome
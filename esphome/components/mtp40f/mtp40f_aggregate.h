@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace mtp40f {
+
+// 집계 창 최대 샘플 수와 스파이크 필터 최대 크기 (정적 할당)
+static constexpr size_t MTP40F_AGGREGATE_MAX_WINDOW = 64;
+static constexpr size_t MTP40F_SPIKE_FILTER_MAX = 5;
+
+// CO2 샘플을 고정 크기 창으로 모아 평균/최소/최대/중앙값을 계산. 동적 할당 없음
+class MTP40FAggregator {
+ public:
+  void set_window_size(uint8_t window_size);
+  void set_spike_filter_size(uint8_t spike_filter_size);
+  uint8_t get_window_size() const { return window_size_; }
+  uint8_t get_spike_filter_size() const { return spike_filter_size_; }
+
+  // 샘플 추가 (O(1)). 창이 가득 차면 true
+  bool add_sample(uint32_t ppm);
+  // 창이 가득 찼을 때만 유효
+  float mean() const { return static_cast<float>(this->sum_) / this->count_; }
+  uint16_t min() const { return this->min_; }
+  uint16_t max() const { return this->max_; }
+  // 창의 샘플 순서를 바꾸므로 창 마다 한 번만 호출
+  uint16_t median();
+  void reset();
+
+ protected:
+  // 최근 N개의 중앙값으로 단발성 튀는 값을 제거
+  uint16_t spike_filter_(uint16_t value);
+
+  uint16_t samples_[MTP40F_AGGREGATE_MAX_WINDOW];
+  uint8_t window_size_{MTP40F_AGGREGATE_MAX_WINDOW};
+  uint8_t count_{0};
+  uint32_t sum_{0};
+  uint16_t min_{UINT16_MAX};
+  uint16_t max_{0};
+
+  uint16_t recent_[MTP40F_SPIKE_FILTER_MAX];
+  uint8_t spike_filter_size_{1};
+  uint8_t recent_count_{0};
+  uint8_t recent_index_{0};
+};
+
+}  // namespace mtp40f
+}  // namespace esphome
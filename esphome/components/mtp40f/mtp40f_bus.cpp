@@ -0,0 +1,107 @@
+#include "mtp40f_bus.h"
+#include "mtp40f.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace mtp40f {
+
+static const char *const TAG = "mtp40f.bus";
+
+std::vector<MTP40FBus::Owner> MTP40FBus::owners_;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+void MTP40FBus::setup() {
+  ESP_LOGCONFIG(TAG, "Setting up MTP40F bus...");
+  for (auto *pin : this->select_pins_) {
+    pin->setup();
+    pin->digital_write(false);
+  }
+  const uint32_t channels = 1 << this->select_pins_.size();
+  for (const Member &member : this->members_) {
+    if (!this->select_pins_.empty() && member.channel >= channels) {
+      ESP_LOGE(TAG, "Mux channel %u needs more than %u select pins", member.channel,
+               (unsigned) this->select_pins_.size());
+      this->mark_failed();
+      return;
+    }
+  }
+}
+
+void MTP40FBus::add_sensor(MTP40FComponent *sensor, uint8_t channel) {
+  // 센서 자체 폴러는 끄고 버스가 시점을 정함
+  sensor->set_update_interval(SCHEDULER_DONT_RUN);
+  sensor->set_bus(this);
+  this->members_.push_back({sensor, channel});
+}
+
+void MTP40FBus::update() {
+  if (this->members_.empty())
+    return;
+  // 업데이트 주기 안에서 센서별 폴링 시점을 균등하게 분산. 타이머 하나를 이어서 사용
+  this->next_member_ = 0;
+  this->poll_next_();
+}
+
+void MTP40FBus::poll_next_() {
+  if (this->next_member_ >= this->members_.size())
+    return;
+  this->members_[this->next_member_++].sensor->update();
+  if (this->next_member_ < this->members_.size()) {
+    const uint32_t spacing = this->get_update_interval() / this->members_.size();
+    this->set_timeout("poll", spacing, [this]() { this->poll_next_(); });
+  }
+}
+
+bool MTP40FBus::acquire(MTP40FComponent *sensor) {
+  // 멀티플렉서가 있으면 이 버스의 모든 센서가 한 UART를 공유
+  const bool shared = !this->select_pins_.empty();
+  uart::UARTComponent *uart = sensor->get_uart_parent();
+  for (const Owner &owner : owners_) {
+    if (owner.sensor == sensor)
+      return true;
+    // 다른 버스에 묶인 센서라도 같은 UART면 대기
+    if (owner.uart == uart || (shared && owner.bus == this))
+      return false;
+  }
+  owners_.push_back({uart, sensor, this});
+
+  if (shared) {
+    for (const Member &member : this->members_) {
+      if (member.sensor == sensor) {
+        this->select_channel_(member.channel);
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+void MTP40FBus::release(MTP40FComponent *sensor) {
+  auto is_sensor = [sensor](const Owner &owner) { return owner.sensor == sensor; };
+  owners_.erase(std::remove_if(owners_.begin(), owners_.end(), is_sensor), owners_.end());
+}
+
+void MTP40FBus::select_channel_(uint8_t channel) {
+  if (this->selected_channel_ == channel)
+    return;
+  for (size_t bit = 0; bit < this->select_pins_.size(); bit++) {
+    this->select_pins_[bit]->digital_write((channel >> bit) & 1);
+  }
+  this->selected_channel_ = channel;
+  ESP_LOGV(TAG, "Selected mux channel %u", channel);
+}
+
+float MTP40FBus::get_setup_priority() const { return setup_priority::DATA; }
+
+void MTP40FBus::dump_config() {
+  ESP_LOGCONFIG(TAG, "MTP40F Bus:");
+  LOG_UPDATE_INTERVAL(this);
+  ESP_LOGCONFIG(TAG, "  Sensors: %u", (unsigned) this->members_.size());
+  for (size_t bit = 0; bit < this->select_pins_.size(); bit++) {
+    LOG_PIN("  Select Pin: ", this->select_pins_[bit]);
+  }
+}
+
+}  // namespace mtp40f
+}  // namespace esphome
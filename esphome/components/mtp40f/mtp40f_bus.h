@@ -0,0 +1,54 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/components/uart/uart.h"
+
+#include <vector>
+
+namespace esphome {
+namespace mtp40f {
+
+class MTP40FComponent;
+
+// 여러 MTP40F를 묶어 폴링 시점을 나누고, UART당 한 번에 하나의 요청만 보내도록 조정
+class MTP40FBus : public PollingComponent {
+ public:
+  void setup() override;
+  void update() override;
+  void dump_config() override;
+  float get_setup_priority() const override;
+
+  void add_sensor(MTP40FComponent *sensor, uint8_t channel);
+  // UART 멀티플렉서 채널 선택 핀 (비트 0부터)
+  void add_select_pin(GPIOPin *pin) { select_pins_.push_back(pin); }
+
+  // 같은 UART(또는 멀티플렉서)를 다른 센서가 쓰고 있으면 false
+  bool acquire(MTP40FComponent *sensor);
+  void release(MTP40FComponent *sensor);
+
+ protected:
+  struct Member {
+    MTP40FComponent *sensor;
+    uint8_t channel;
+  };
+  struct Owner {
+    uart::UARTComponent *uart;
+    MTP40FComponent *sensor;
+    MTP40FBus *bus;
+  };
+
+  void select_channel_(uint8_t channel);
+  // 다음 센서를 폴링하고, 남은 센서가 있으면 간격 뒤에 다시 호출
+  void poll_next_();
+
+  std::vector<Member> members_;
+  std::vector<GPIOPin *> select_pins_;
+  size_t next_member_{0};
+  int16_t selected_channel_{-1};
+  // 요청 중인 센서 목록. 물리 UART당 최대 1개이므로 모든 버스가 함께 사용
+  static std::vector<Owner> owners_;
+};
+
+}  // namespace mtp40f
+}  // namespace esphome
@@ -0,0 +1,79 @@
+#include "mtp40f_metrics.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace mtp40f {
+
+template<size_t N> static size_t find_bucket(const uint16_t (&limits)[N], uint32_t value) {
+  size_t bucket = 0;
+  while (bucket < N && value >= limits[bucket])
+    bucket++;
+  return bucket;
+}
+
+void MTP40FMetrics::record_success(uint8_t opcode, uint32_t rtt_ms) {
+  this->counters_(opcode).success++;
+  this->last_rtt_ms_ = rtt_ms;
+  this->rtt_buckets_[find_bucket(MTP40F_RTT_BUCKET_LIMITS_MS, rtt_ms)]++;
+}
+
+void MTP40FMetrics::record_loop_time(uint32_t us) {
+  this->loop_buckets_[find_bucket(MTP40F_LOOP_BUCKET_LIMITS_US, us)]++;
+  this->max_loop_time_us_ = std::max(this->max_loop_time_us_, us);
+  this->window_max_loop_time_us_ = std::max(this->window_max_loop_time_us_, us);
+}
+
+uint32_t MTP40FMetrics::take_max_loop_time_us() {
+  uint32_t value = this->window_max_loop_time_us_;
+  this->window_max_loop_time_us_ = 0;
+  return value;
+}
+
+uint32_t MTP40FMetrics::total_success() const {
+  uint32_t total = 0;
+  for (const auto &counters : this->opcodes_)
+    total += counters.success;
+  return total;
+}
+
+uint32_t MTP40FMetrics::total_timeouts() const {
+  uint32_t total = 0;
+  for (const auto &counters : this->opcodes_)
+    total += counters.timeout;
+  return total;
+}
+
+uint32_t MTP40FMetrics::total_crc_errors() const {
+  uint32_t total = 0;
+  for (const auto &counters : this->opcodes_)
+    total += counters.crc;
+  return total;
+}
+
+uint32_t MTP40FMetrics::total_invalid_gas() const {
+  uint32_t total = 0;
+  for (const auto &counters : this->opcodes_)
+    total += counters.invalid_gas;
+  return total;
+}
+
+void MTP40FMetrics::dump_config(const char *tag) const {
+  ESP_LOGCONFIG(tag, "  Transactions (opcode: ok/timeout/crc/invalid gas):");
+  for (size_t opcode = 0; opcode < MTP40F_METRICS_OPCODE_COUNT; opcode++) {
+    const auto &c = this->opcodes_[opcode];
+    if (c.success == 0 && c.timeout == 0 && c.crc == 0 && c.invalid_gas == 0)
+      continue;
+    ESP_LOGCONFIG(tag, "    0x%02X: %u/%u/%u/%u", (unsigned) opcode, c.success, c.timeout, c.crc, c.invalid_gas);
+  }
+  ESP_LOGCONFIG(tag, "  Round trip (ms) <25:%u <50:%u <100:%u <200:%u <500:%u <1000:%u >=1000:%u",
+                this->rtt_buckets_[0], this->rtt_buckets_[1], this->rtt_buckets_[2], this->rtt_buckets_[3],
+                this->rtt_buckets_[4], this->rtt_buckets_[5], this->rtt_buckets_[6]);
+  ESP_LOGCONFIG(tag, "  Loop time (us) <50:%u <100:%u <250:%u <500:%u <1000:%u >=1000:%u, max %u",
+                this->loop_buckets_[0], this->loop_buckets_[1], this->loop_buckets_[2], this->loop_buckets_[3],
+                this->loop_buckets_[4], this->loop_buckets_[5], this->max_loop_time_us_);
+}
+
+}  // namespace mtp40f
+}  // namespace esphome
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace mtp40f {
+
+// 명령 코드(0x00~0x07)별 카운터
+static constexpr size_t MTP40F_METRICS_OPCODE_COUNT = 8;
+
+// 고정 구간 히스토그램. 마지막 구간은 상한 없음
+static constexpr size_t MTP40F_RTT_BUCKET_COUNT = 7;
+static constexpr uint16_t MTP40F_RTT_BUCKET_LIMITS_MS[MTP40F_RTT_BUCKET_COUNT - 1] = {25, 50, 100, 200, 500, 1000};
+static constexpr size_t MTP40F_LOOP_BUCKET_COUNT = 6;
+static constexpr uint16_t MTP40F_LOOP_BUCKET_LIMITS_US[MTP40F_LOOP_BUCKET_COUNT - 1] = {50, 100, 250, 500, 1000};
+
+struct MTP40FOpcodeCounters {
+  uint32_t success;
+  uint32_t timeout;
+  uint32_t crc;
+  uint32_t invalid_gas;
+};
+
+// 요청 결과 카운터와 응답/루프 시간 히스토그램. 정적 배열만 사용하므로 상시 켜두어도 부담 없음
+class MTP40FMetrics {
+ public:
+  void record_success(uint8_t opcode, uint32_t rtt_ms);
+  void record_timeout(uint8_t opcode) { this->counters_(opcode).timeout++; }
+  void record_crc_error(uint8_t opcode) { this->counters_(opcode).crc++; }
+  void record_invalid_gas(uint8_t opcode) { this->counters_(opcode).invalid_gas++; }
+  void record_loop_time(uint32_t us);
+
+  // 전체 명령 합계
+  uint32_t total_success() const;
+  uint32_t total_timeouts() const;
+  uint32_t total_crc_errors() const;
+  uint32_t total_invalid_gas() const;
+  uint32_t get_last_rtt_ms() const { return last_rtt_ms_; }
+  uint32_t get_max_loop_time_us() const { return max_loop_time_us_; }
+  // 마지막 조회 이후 최대 루프 시간을 돌려주고 초기화
+  uint32_t take_max_loop_time_us();
+
+  void dump_config(const char *tag) const;
+
+ protected:
+  MTP40FOpcodeCounters &counters_(uint8_t opcode) { return this->opcodes_[opcode % MTP40F_METRICS_OPCODE_COUNT]; }
+
+  MTP40FOpcodeCounters opcodes_[MTP40F_METRICS_OPCODE_COUNT]{};
+  uint32_t rtt_buckets_[MTP40F_RTT_BUCKET_COUNT]{};
+  uint32_t loop_buckets_[MTP40F_LOOP_BUCKET_COUNT]{};
+  uint32_t last_rtt_ms_{0};
+  uint32_t max_loop_time_us_{0};
+  uint32_t window_max_loop_time_us_{0};
+};
+
+}  // namespace mtp40f
+}  // namespace esphome
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace mtp40f {
+
+// 프레임 구조: 42 4D A0 | 명령(2) | 데이터 길이(2) | 데이터(n) | 체크섬(2)
+static constexpr uint8_t MTP40F_FRAME_HEADER[] = {0x42, 0x4D, 0xA0};
+static constexpr size_t MTP40F_FRAME_HEADER_LENGTH = 7;
+static constexpr size_t MTP40F_FRAME_OVERHEAD = MTP40F_FRAME_HEADER_LENGTH + 2;
+// 가장 긴 응답 데이터 길이. CO2 응답(5)이 항상 가장 김 (대기압 2, 자기보정/보정 1)
+static constexpr size_t MTP40F_MAX_PAYLOAD_LENGTH = 5;
+// 응답을 기다리지 않는 명령
+static constexpr size_t MTP40F_NO_RESPONSE = SIZE_MAX;
+
+constexpr size_t mtp40f_next_power_of_two(size_t value) {
+  size_t result = 1;
+  while (result < value)
+    result <<= 1;
+  return result;
+}
+
+// 수신 링 버퍼 (2의 거듭제곱, 최대 프레임 2개 이상)
+static constexpr size_t MTP40F_RX_BUFFER_SIZE =
+    mtp40f_next_power_of_two(2 * (MTP40F_FRAME_OVERHEAD + MTP40F_MAX_PAYLOAD_LENGTH));
+static constexpr size_t MTP40F_RX_BUFFER_MASK = MTP40F_RX_BUFFER_SIZE - 1;
+static_assert((MTP40F_RX_BUFFER_SIZE & MTP40F_RX_BUFFER_MASK) == 0, "RX buffer size must be a power of two");
+static_assert(MTP40F_RX_BUFFER_SIZE >= 2 * (MTP40F_FRAME_OVERHEAD + MTP40F_MAX_PAYLOAD_LENGTH),
+              "RX buffer must hold two full frames");
+
+// 16비트 합 체크섬
+constexpr uint16_t mtp40f_sum(const uint8_t *data, size_t length) {
+  uint16_t sum = 0;
+  for (size_t i = 0; i < length; i++)
+    sum += data[i];
+  return sum;
+}
+
+// 체크섬까지 포함된 완성 프레임. 길이가 타입에 들어 있음
+template<size_t PayloadLength> struct MTP40FFrame {
+  static constexpr size_t LENGTH = MTP40F_FRAME_OVERHEAD + PayloadLength;
+  uint8_t data[LENGTH];
+};
+
+template<size_t PayloadLength>
+constexpr MTP40FFrame<PayloadLength> mtp40f_build_frame(uint8_t opcode,
+                                                         const std::array<uint8_t, PayloadLength> &payload) {
+  MTP40FFrame<PayloadLength> frame{};
+  frame.data[0] = MTP40F_FRAME_HEADER[0];
+  frame.data[1] = MTP40F_FRAME_HEADER[1];
+  frame.data[2] = MTP40F_FRAME_HEADER[2];
+  frame.data[3] = 0x00;
+  frame.data[4] = opcode;
+  frame.data[5] = static_cast<uint8_t>(PayloadLength >> 8);
+  frame.data[6] = static_cast<uint8_t>(PayloadLength & 0xFF);
+  for (size_t i = 0; i < PayloadLength; i++)
+    frame.data[MTP40F_FRAME_HEADER_LENGTH + i] = payload[i];
+  uint16_t sum = mtp40f_sum(frame.data, MTP40F_FRAME_HEADER_LENGTH + PayloadLength);
+  frame.data[MTP40F_FRAME_HEADER_LENGTH + PayloadLength] = static_cast<uint8_t>(sum >> 8);
+  frame.data[MTP40F_FRAME_HEADER_LENGTH + PayloadLength + 1] = static_cast<uint8_t>(sum & 0xFF);
+  return frame;
+}
+
+// 링 버퍼 안의 프레임을 복사 없이 가리키는 뷰. 다음 수신 전까지만 유효
+class MTP40FFrameView {
+ public:
+  MTP40FFrameView() = default;
+  MTP40FFrameView(const uint8_t *buffer, size_t start, size_t length)
+      : buffer_(buffer), start_(start), length_(length) {}
+
+  uint8_t operator[](size_t index) const { return this->buffer_[(this->start_ + index) & MTP40F_RX_BUFFER_MASK]; }
+  size_t size() const { return this->length_; }
+  uint8_t command() const { return (*this)[4]; }
+  uint16_t payload_length() const { return ((*this)[5] << 8) | (*this)[6]; }
+  uint8_t payload(size_t index) const { return (*this)[MTP40F_FRAME_HEADER_LENGTH + index]; }
+
+ protected:
+  const uint8_t *buffer_{nullptr};
+  size_t start_{0};
+  size_t length_{0};
+};
+
+// 명령 정의: 명령 코드, 요청 데이터 길이, 응답 데이터 길이
+template<uint8_t Opcode, size_t RequestPayloadLength, size_t ResponsePayloadLength> struct MTP40FCommand {
+  static_assert(ResponsePayloadLength == MTP40F_NO_RESPONSE || ResponsePayloadLength <= MTP40F_MAX_PAYLOAD_LENGTH,
+                "response does not fit the RX buffer");
+
+  using Frame = MTP40FFrame<RequestPayloadLength>;
+  static constexpr uint8_t OPCODE = Opcode;
+  static constexpr size_t REQUEST_LENGTH = Frame::LENGTH;
+  static constexpr size_t RESPONSE_LENGTH =
+      ResponsePayloadLength == MTP40F_NO_RESPONSE ? 0 : MTP40F_FRAME_OVERHEAD + ResponsePayloadLength;
+
+  static constexpr Frame build(const std::array<uint8_t, RequestPayloadLength> &payload) {
+    return mtp40f_build_frame<RequestPayloadLength>(Opcode, payload);
+  }
+};
+
+// 0x01 대기압 참조값 설정 (hPa, big endian)
+struct MTP40FSetAirPressureReference : MTP40FCommand<0x01, 2, MTP40F_NO_RESPONSE> {
+  static constexpr Frame build_for(uint16_t hpa) {
+    return build({static_cast<uint8_t>(hpa >> 8), static_cast<uint8_t>(hpa & 0xFF)});
+  }
+};
+
+// 0x02 대기압 참조값 읽기
+struct MTP40FGetAirPressureReference : MTP40FCommand<0x02, 0, 2> {
+  static constexpr Frame FRAME = build({});
+  static uint16_t decode(const MTP40FFrameView &frame) { return (frame.payload(0) << 8) | frame.payload(1); }
+};
+
+// 0x03 CO2 농도 읽기
+struct MTP40FGetGasConcentration : MTP40FCommand<0x03, 0, 5> {
+  struct Response {
+    uint32_t ppm;
+    uint8_t status;  // 0x00 = 유효
+  };
+  static constexpr Frame FRAME = build({});
+  static Response decode(const MTP40FFrameView &frame) {
+    return {static_cast<uint32_t>(frame.payload(0)) << 24 | static_cast<uint32_t>(frame.payload(1)) << 16 |
+                static_cast<uint32_t>(frame.payload(2)) << 8 | frame.payload(3),
+            frame.payload(4)};
+  }
+};
+
+// 0x04 단일점 보정 (ppm, big endian)
+struct MTP40FSinglePointCorrection : MTP40FCommand<0x04, 4, 1> {
+  static constexpr Frame build_for(uint32_t ppm) {
+    return build({static_cast<uint8_t>(ppm >> 24), static_cast<uint8_t>(ppm >> 16), static_cast<uint8_t>(ppm >> 8),
+                  static_cast<uint8_t>(ppm & 0xFF)});
+  }
+  static constexpr Frame FRAME_400PPM = build({0x00, 0x00, 0x01, 0x90});  // 400ppm = 0x0190
+};
+
+// 0x06 자기보정 설정 (0x00 = 켜기, 0xFF = 끄기)
+struct MTP40FSetSelfCalibration : MTP40FCommand<0x06, 1, 0> {
+  static constexpr Frame FRAME_ENABLE = build({0x00});
+  static constexpr Frame FRAME_DISABLE = build({0xFF});
+};
+
+// 0x07 자기보정 상태 읽기
+struct MTP40FGetSelfCalibration : MTP40FCommand<0x07, 0, 1> {
+  static constexpr Frame FRAME = build({});
+  static uint8_t decode(const MTP40FFrameView &frame) { return frame.payload(0); }
+};
+
+static_assert(MTP40FGetGasConcentration::FRAME.data[7] == 0x01 && MTP40FGetGasConcentration::FRAME.data[8] == 0x32,
+              "GET_PPM checksum");
+
+}  // namespace mtp40f
+}  // namespace esphome
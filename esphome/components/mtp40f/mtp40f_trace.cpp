@@ -0,0 +1,49 @@
+#include "mtp40f_trace.h"
+
+#ifdef USE_MTP40F_TRACE
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace mtp40f {
+
+MTP40FTraceEntry &MTP40FTrace::next_(MTP40FTraceKind kind, size_t length, uint16_t error) {
+  MTP40FTraceEntry &entry = this->entries_[this->count_++ % MTP40F_TRACE_SIZE];
+  entry.time_us = micros();
+  entry.error = error;
+  entry.kind = kind;
+  entry.length = std::min(length, MTP40F_TRACE_FRAME_LENGTH);
+  return entry;
+}
+
+void MTP40FTrace::record(MTP40FTraceKind kind, const uint8_t *data, size_t length, uint16_t error) {
+  MTP40FTraceEntry &entry = this->next_(kind, length, error);
+  std::copy(data, data + entry.length, entry.data);
+}
+
+void MTP40FTrace::record(MTP40FTraceKind kind, const MTP40FFrameView &frame, uint16_t error) {
+  MTP40FTraceEntry &entry = this->next_(kind, frame.size(), error);
+  for (size_t i = 0; i < entry.length; i++)
+    entry.data[i] = frame[i];
+}
+
+void MTP40FTrace::dump(const char *tag) const {
+  static const char *const KINDS[] = {"TX", "RX", "ER"};
+  const uint32_t stored = std::min<uint32_t>(this->count_, MTP40F_TRACE_SIZE);
+  ESP_LOGI(tag, "Trace: last %u of %u frames", stored, this->count_);
+  // 오래된 것부터 출력
+  for (uint32_t i = this->count_ - stored; i != this->count_; i++) {
+    const MTP40FTraceEntry &entry = this->entries_[i % MTP40F_TRACE_SIZE];
+    ESP_LOGI(tag, "  %10u us %s 0x%04X %s", entry.time_us, KINDS[entry.kind % 3], entry.error,
+             format_hex_pretty(entry.data, entry.length).c_str());
+  }
+}
+
+}  // namespace mtp40f
+}  // namespace esphome
+
+#endif  // USE_MTP40F_TRACE
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_MTP40F_TRACE
+
+#include "mtp40f_protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace mtp40f {
+
+// 저장할 최근 프레임 수. sensor.py의 trace.size로 정해짐
+#ifndef MTP40F_TRACE_SIZE
+#define MTP40F_TRACE_SIZE 16
+#endif
+static constexpr size_t MTP40F_TRACE_FRAME_LENGTH = MTP40F_FRAME_OVERHEAD + MTP40F_MAX_PAYLOAD_LENGTH;
+
+enum MTP40FTraceKind : uint8_t {
+  MTP40F_TRACE_TX = 0,
+  MTP40F_TRACE_RX,
+  MTP40F_TRACE_ERROR,  // data에는 오류가 난 프레임 또는 명령 코드
+};
+
+struct MTP40FTraceEntry {
+  uint32_t time_us;
+  uint16_t error;
+  uint8_t kind;
+  uint8_t length;
+  uint8_t data[MTP40F_TRACE_FRAME_LENGTH];
+};
+
+// 최근 송수신 프레임의 고정 크기 링. 기록할 때는 복사만 하고 문자열 변환은 dump()에서만 수행
+class MTP40FTrace {
+ public:
+  void record(MTP40FTraceKind kind, const uint8_t *data, size_t length, uint16_t error = 0);
+  void record(MTP40FTraceKind kind, const MTP40FFrameView &frame, uint16_t error = 0);
+  void dump(const char *tag) const;
+
+ protected:
+  MTP40FTraceEntry &next_(MTP40FTraceKind kind, size_t length, uint16_t error);
+
+  MTP40FTraceEntry entries_[MTP40F_TRACE_SIZE]{};
+  uint32_t count_{0};  // 지금까지 기록한 수. 위치는 count_ % MTP40F_TRACE_SIZE
+};
+
+}  // namespace mtp40f
+}  // namespace esphome
+
+#endif  // USE_MTP40F_TRACE
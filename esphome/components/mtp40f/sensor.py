@@ -1,28 +1,184 @@
-from esphome import automation
+from esphome import automation, pins
 from esphome.automation import maybe_simple_id
 import esphome.codegen as cg
 from esphome.components import sensor, uart
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome.const import (
     CONF_CO2,
     CONF_ID,
+    CONF_PLATFORM,
+    CONF_SIZE,
+    CONF_WINDOW_SIZE,
     DEVICE_CLASS_CARBON_DIOXIDE,
+    DEVICE_CLASS_DURATION,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     ICON_MOLECULE_CO2,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_MICROSECOND,
+    UNIT_MILLISECOND,
+    UNIT_SECOND,
     UNIT_PARTS_PER_MILLION,
     UNIT_HECTOPASCAL,  # 대기압 단위 hPa
 )
+from . import MTP40FBus
 
 DEPENDENCIES = ["uart"]
 
 CONF_SELF_CALIBRATION = "self_calibration"
 CONF_WARMUP_TIME = "warmup_time"
+CONF_POWER_DURING_SLEEP = "power_during_sleep"
 CONF_AIR_PRESSURE_REFERENCE = "air_pressure_reference"
 CONF_EXTERNAL_AIR_PRESSURE = "external_air_pressure"
+CONF_MTP40F_BUS_ID = "mtp40f_bus_id"
+CONF_MUX_CHANNEL = "mux_channel"
+CONF_AGGREGATE = "aggregate"
+CONF_SPIKE_FILTER = "spike_filter"
+CONF_MEAN = "mean"
+CONF_MIN = "min"
+CONF_MAX = "max"
+CONF_MEDIAN = "median"
+CONF_DEADBAND = "deadband"
+CONF_ABSOLUTE = "absolute"
+CONF_RELATIVE = "relative"
+CONF_HEARTBEAT = "heartbeat"
+CONF_REFRESH_INTERVAL = "refresh_interval"
+CONF_TIMEOUT_COUNT = "timeout_count"
+CONF_CRC_ERROR_COUNT = "crc_error_count"
+CONF_INVALID_GAS_COUNT = "invalid_gas_count"
+CONF_ROUND_TRIP_TIME = "round_trip_time"
+CONF_LOOP_TIME = "loop_time"
+CONF_ADAPTIVE_POLLING = "adaptive_polling"
+CONF_MIN_INTERVAL = "min_interval"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_FAST_SLOPE = "fast_slope"
+CONF_INTERVAL = "interval"
+CONF_READINESS = "readiness"
+CONF_SAMPLES = "samples"
+CONF_TOLERANCE = "tolerance"
+CONF_POWER_PIN = "power_pin"
+CONF_POWER_CYCLE_AFTER = "power_cycle_after"
+CONF_TRACE = "trace"
+CONF_DUMP_ON_ERROR = "dump_on_error"
+
+# mtp40f_aggregate.h 의 MTP40F_AGGREGATE_MAX_WINDOW 와 일치
+AGGREGATE_MAX_WINDOW = 64
 
 mtp40f_ns = cg.esphome_ns.namespace("mtp40f")
 MTP40FComponent = mtp40f_ns.class_("MTP40FComponent", cg.PollingComponent, uart.UARTDevice)
 MTP40FCalibrate400ppmAction = mtp40f_ns.class_("MTP40FCalibrate400ppmAction", automation.Action)
+MTP40FDumpTraceAction = mtp40f_ns.class_("MTP40FDumpTraceAction", automation.Action)
+
+CO2_AGGREGATE_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_PARTS_PER_MILLION,
+    icon=ICON_MOLECULE_CO2,
+    accuracy_decimals=0,
+    device_class=DEVICE_CLASS_CARBON_DIOXIDE,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+
+# 변화량이 임계값 이하면 발행 생략, heartbeat 간격마다 강제 발행
+DEADBAND_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_ABSOLUTE, default=0): cv.positive_float,
+        cv.Optional(CONF_RELATIVE, default="0%"): cv.percentage,
+        cv.Optional(CONF_HEARTBEAT, default="0s"): cv.positive_time_period_milliseconds,
+    }
+)
+
+AGGREGATE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_WINDOW_SIZE, default=30): cv.int_range(min=1, max=AGGREGATE_MAX_WINDOW),
+        cv.Optional(CONF_SPIKE_FILTER, default=1): cv.one_of(1, 3, 5, int=True),
+        cv.Optional(CONF_MEAN): CO2_AGGREGATE_SENSOR_SCHEMA,
+        cv.Optional(CONF_MIN): CO2_AGGREGATE_SENSOR_SCHEMA,
+        cv.Optional(CONF_MAX): CO2_AGGREGATE_SENSOR_SCHEMA,
+        cv.Optional(CONF_MEDIAN): CO2_AGGREGATE_SENSOR_SCHEMA,
+    }
+)
+
+# CO2 변화 속도(ppm/min)가 fast_slope 이상이면 min_interval, 평탄하면 max_interval 까지 점차 늘림
+def validate_adaptive_polling(config):
+    if config[CONF_MIN_INTERVAL] > config[CONF_MAX_INTERVAL]:
+        raise cv.Invalid("min_interval must not be greater than max_interval")
+    return config
+
+
+ADAPTIVE_POLLING_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            # update()의 2초 가드보다 짧을 수 없음
+            cv.Optional(CONF_MIN_INTERVAL, default="5s"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(seconds=2)),
+            ),
+            cv.Optional(CONF_MAX_INTERVAL, default="5min"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_FAST_SLOPE, default=50): cv.positive_float,
+            cv.Optional(CONF_INTERVAL): sensor.sensor_schema(
+                unit_of_measurement=UNIT_SECOND,
+                icon="mdi:timer-outline",
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+        }
+    ),
+    validate_adaptive_polling,
+)
+
+# 연속 측정값이 tolerance 안에 samples번 들어오면 warmup_time 전이라도 발행 시작
+READINESS_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_SAMPLES, default=3): cv.int_range(min=2, max=20),
+        cv.Optional(CONF_TOLERANCE, default=20): cv.int_range(min=0, max=1000),
+        cv.Optional(CONF_INTERVAL, default="2s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(seconds=2)),
+        ),
+    }
+)
+
+# 최근 송수신 프레임 기록 (USE_MTP40F_TRACE). 설정하지 않으면 코드와 버퍼가 모두 빠짐
+TRACE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_SIZE, default=16): cv.int_range(min=2, max=128),
+        cv.Optional(CONF_DUMP_ON_ERROR, default=True): cv.boolean,
+    }
+)
+
+# 진단용 카운터와 시간 센서
+COUNTER_SENSOR_SCHEMA = sensor.sensor_schema(
+    icon="mdi:counter",
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+DIAGNOSTIC_SENSORS = {
+    CONF_TIMEOUT_COUNT: ("set_timeout_count_sensor", COUNTER_SENSOR_SCHEMA),
+    CONF_CRC_ERROR_COUNT: ("set_crc_error_count_sensor", COUNTER_SENSOR_SCHEMA),
+    CONF_INVALID_GAS_COUNT: ("set_invalid_gas_count_sensor", COUNTER_SENSOR_SCHEMA),
+    CONF_ROUND_TRIP_TIME: (
+        "set_round_trip_time_sensor",
+        sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=0,
+            device_class=DEVICE_CLASS_DURATION,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    ),
+    CONF_LOOP_TIME: (
+        "set_loop_time_sensor",
+        sensor.sensor_schema(
+            unit_of_measurement=UNIT_MICROSECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    ),
+}
 
 CONFIG_SCHEMA = (
     cv.Schema(
@@ -34,7 +190,7 @@ CONFIG_SCHEMA = (
                 accuracy_decimals=0,
                 device_class=DEVICE_CLASS_CARBON_DIOXIDE,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend({cv.Optional(CONF_DEADBAND): DEADBAND_SCHEMA}),
             cv.Optional(CONF_EXTERNAL_AIR_PRESSURE): cv.use_id(sensor.Sensor),
             cv.Optional(CONF_AIR_PRESSURE_REFERENCE): sensor.sensor_schema(
                 unit_of_measurement=UNIT_HECTOPASCAL,
@@ -42,15 +198,51 @@ CONFIG_SCHEMA = (
                 accuracy_decimals=0,
                 device_class="pressure",
                 state_class=STATE_CLASS_MEASUREMENT,
+            ).extend(
+                {
+                    cv.Optional(CONF_DEADBAND): DEADBAND_SCHEMA,
+                    # 캐시된 값이 이 시간 안이면 센서를 다시 읽지 않음
+                    cv.Optional(CONF_REFRESH_INTERVAL, default="10min"): cv.positive_time_period_milliseconds,
+                }
             ),
             cv.Optional(CONF_SELF_CALIBRATION, default=True): cv.boolean,
             cv.Optional(CONF_WARMUP_TIME, default="60s"): cv.positive_time_period_seconds,
+            cv.Optional(CONF_READINESS): READINESS_SCHEMA,
+            # 센서 전원이 딥슬립 동안 유지되는 경우 예열 상태를 RTC 메모리에 보존
+            cv.Optional(CONF_POWER_DURING_SLEEP, default=False): cv.boolean,
+            cv.Optional(CONF_AGGREGATE): AGGREGATE_SCHEMA,
+            cv.Optional(CONF_ADAPTIVE_POLLING): ADAPTIVE_POLLING_SCHEMA,
+            # 연속 실패가 power_cycle_after번 쌓이면 센서 전원을 껐다 켬
+            cv.Optional(CONF_POWER_PIN): pins.gpio_output_pin_schema,
+            cv.Optional(CONF_POWER_CYCLE_AFTER, default=5): cv.int_range(min=1, max=255),
+            cv.Optional(CONF_TRACE): TRACE_SCHEMA,
+            cv.Optional(CONF_MTP40F_BUS_ID): cv.use_id(MTP40FBus),
+            cv.Optional(CONF_MUX_CHANNEL, default=0): cv.int_range(min=0, max=255),
         }
     )
+    .extend({cv.Optional(key): schema for key, (_, schema) in DIAGNOSTIC_SENSORS.items()})
     .extend(cv.polling_component_schema("60s"))
     .extend(uart.UART_DEVICE_SCHEMA)
 )
 
+
+# 링 크기는 컴파일 시간 상수이므로 모든 센서가 같은 값을 써야 함
+def _final_validate_trace(config):
+    if CONF_TRACE not in config:
+        return config
+    sizes = {
+        conf[CONF_TRACE][CONF_SIZE]
+        for conf in fv.full_config.get().get("sensor", [])
+        if conf.get(CONF_PLATFORM) == "mtp40f" and CONF_TRACE in conf
+    }
+    if len(sizes) > 1:
+        raise cv.Invalid("All mtp40f sensors must use the same trace size")
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate_trace
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
@@ -59,17 +251,96 @@ async def to_code(config):
     if CONF_CO2 in config:
         sens = await sensor.new_sensor(config[CONF_CO2])
         cg.add(var.set_co2_sensor(sens))
+        if CONF_DEADBAND in config[CONF_CO2]:
+            deadband = config[CONF_CO2][CONF_DEADBAND]
+            cg.add(
+                var.set_co2_deadband(
+                    deadband[CONF_ABSOLUTE],
+                    deadband[CONF_RELATIVE],
+                    deadband[CONF_HEARTBEAT].total_milliseconds,
+                )
+            )
 
     if CONF_AIR_PRESSURE_REFERENCE in config:
+        cg.add_define("USE_MTP40F_AIR_PRESSURE_REFERENCE")
         sens = await sensor.new_sensor(config[CONF_AIR_PRESSURE_REFERENCE])
         cg.add(var.set_air_pressure_reference_sensor(sens))
+        pressure_config = config[CONF_AIR_PRESSURE_REFERENCE]
+        cg.add(var.set_air_pressure_reference_refresh(pressure_config[CONF_REFRESH_INTERVAL].total_milliseconds))
+        if CONF_DEADBAND in pressure_config:
+            deadband = pressure_config[CONF_DEADBAND]
+            cg.add(
+                var.set_air_pressure_reference_deadband(
+                    deadband[CONF_ABSOLUTE],
+                    deadband[CONF_RELATIVE],
+                    deadband[CONF_HEARTBEAT].total_milliseconds,
+                )
+            )
 
     if CONF_EXTERNAL_AIR_PRESSURE in config:
+        cg.add_define("USE_MTP40F_EXTERNAL_AIR_PRESSURE")
         sens = await cg.get_variable(config[CONF_EXTERNAL_AIR_PRESSURE])
         cg.add(var.set_external_air_pressure_sensor(sens))
 
     cg.add(var.set_self_calibration_enabled(config[CONF_SELF_CALIBRATION]))
     cg.add(var.set_warmup_seconds(config[CONF_WARMUP_TIME].total_seconds))
+    cg.add(var.set_power_during_sleep(config[CONF_POWER_DURING_SLEEP]))
+    if CONF_POWER_PIN in config:
+        pin = await cg.gpio_pin_expression(config[CONF_POWER_PIN])
+        cg.add(var.set_power_pin(pin))
+        cg.add(var.set_power_cycle_after(config[CONF_POWER_CYCLE_AFTER]))
+    if CONF_READINESS in config:
+        readiness = config[CONF_READINESS]
+        cg.add(
+            var.set_readiness(
+                readiness[CONF_SAMPLES],
+                readiness[CONF_TOLERANCE],
+                readiness[CONF_INTERVAL].total_milliseconds,
+            )
+        )
+
+    if CONF_AGGREGATE in config:
+        aggregate = config[CONF_AGGREGATE]
+        cg.add(var.set_aggregate_window_size(aggregate[CONF_WINDOW_SIZE]))
+        cg.add(var.set_aggregate_spike_filter_size(aggregate[CONF_SPIKE_FILTER]))
+        for key, setter in (
+            (CONF_MEAN, var.set_co2_mean_sensor),
+            (CONF_MIN, var.set_co2_min_sensor),
+            (CONF_MAX, var.set_co2_max_sensor),
+            (CONF_MEDIAN, var.set_co2_median_sensor),
+        ):
+            if key in aggregate:
+                sens = await sensor.new_sensor(aggregate[key])
+                cg.add(setter(sens))
+
+    if CONF_ADAPTIVE_POLLING in config:
+        adaptive = config[CONF_ADAPTIVE_POLLING]
+        cg.add(
+            var.set_adaptive_polling(
+                adaptive[CONF_MIN_INTERVAL].total_milliseconds,
+                adaptive[CONF_MAX_INTERVAL].total_milliseconds,
+                adaptive[CONF_FAST_SLOPE],
+            )
+        )
+        if CONF_INTERVAL in adaptive:
+            sens = await sensor.new_sensor(adaptive[CONF_INTERVAL])
+            cg.add(var.set_interval_sensor(sens))
+
+    for key, (setter, _) in DIAGNOSTIC_SENSORS.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, setter)(sens))
+
+    if CONF_TRACE in config:
+        trace = config[CONF_TRACE]
+        cg.add_define("USE_MTP40F_TRACE")
+        cg.add_define("MTP40F_TRACE_SIZE", trace[CONF_SIZE])
+        cg.add(var.set_trace_dump_on_error(trace[CONF_DUMP_ON_ERROR]))
+
+    # 버스에 등록되면 update_interval 대신 버스 주기로 폴링
+    if CONF_MTP40F_BUS_ID in config:
+        bus = await cg.get_variable(config[CONF_MTP40F_BUS_ID])
+        cg.add(bus.add_sensor(var, config[CONF_MUX_CHANNEL]))
 
 # === 400ppm zero calibration 액션 ===
 CALIBRATE_400PPM_ACTION_SCHEMA = maybe_simple_id(
@@ -82,5 +353,22 @@ CALIBRATE_400PPM_ACTION_SCHEMA = maybe_simple_id(
     "mtp40f.calibrate_400ppm", MTP40FCalibrate400ppmAction, CALIBRATE_400PPM_ACTION_SCHEMA
 )
 async def mtp40f_calibrate_400ppm_to_code(config, action_id, template_arg, args):
+    cg.add_define("USE_MTP40F_CALIBRATION")
+    paren = await cg.get_variable(config[CONF_ID])
+    return cg.new_Pvariable(action_id, template_arg, paren)
+
+# === 최근 프레임 기록 출력 액션 ===
+# trace를 설정하지 않은 센서에 쓰면 기본 크기로 기록을 켬
+DUMP_TRACE_ACTION_SCHEMA = maybe_simple_id(
+    {
+        cv.Required(CONF_ID): cv.use_id(MTP40FComponent),
+    }
+)
+
+@automation.register_action(
+    "mtp40f.dump_trace", MTP40FDumpTraceAction, DUMP_TRACE_ACTION_SCHEMA
+)
+async def mtp40f_dump_trace_to_code(config, action_id, template_arg, args):
+    cg.add_define("USE_MTP40F_TRACE")
     paren = await cg.get_variable(config[CONF_ID])
     return cg.new_Pvariable(action_id, template_arg, paren)
@@ -13,6 +13,7 @@ CONFIG_SCHEMA = switch.switch_schema(MTP40FSelfCalibrationSwitch).extend({
 })
 
 async def to_code(config):
+    cg.add_define("USE_MTP40F_SELF_CALIBRATION_SWITCH")
     paren = await cg.get_variable(config["mtp40f_id"])
     var = await switch.new_switch(config)
     cg.add(var.set_parent(paren))
@@ -0,0 +1,261 @@
+// Wake/sleep lifecycle on the host sleep HAL: what begin_sleep() arms, what the next boot sees and what survives
+// in between.
+
+#include "deep_sleep_firmware.h"
+
+#include <gtest/gtest.h>
+
+namespace esphome {
+namespace testing {
+
+static constexpr uint64_t S = 1000000;
+static constexpr uint64_t LOOP_US = 16000;
+
+static SleepTrace constant_trace(float value) {
+  SleepTrace trace;
+  trace.values.push_back({0, value});
+  return trace;
+}
+
+TEST(DeepSleepLifecycle, SetupCountsRequiredSensors) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.sleep_ms = 60000;
+  config.sleep_when_published = true;
+  SleepSimulator sim(device_factory(config, &trace));
+  sim.run_for_ms(100);
+
+  EXPECT_EQ(count_log_lines(ESPHOME_LOG_LEVEL_DEBUG, "Deep Sleep will start once 1 sensors have published"), 1u);
+}
+
+TEST(DeepSleepLifecycle, RecordsTheTimerAndWakesOnIt) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.sleep_ms = 60000;
+  config.sleep_when_published = true;
+  SleepSimulator sim(device_factory(config, &trace));
+  sim.run_for_ms(3000);
+
+  ASSERT_TRUE(sim.is_asleep());
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].timer_us, 60 * S);
+  EXPECT_EQ(records[0].wakeup_pin, -1);
+  // Published after 1.5 s, then the 0.5 s grace delay
+  EXPECT_GE(records[0].awake_ms, 2000u);
+  EXPECT_LE(records[0].awake_ms, 2000u + 2 * LOOP_US / 1000);
+
+  sim.run_for_ms(60000);
+  const auto &wakes = sim.get_wakes();
+  ASSERT_EQ(wakes.size(), 2u);
+  EXPECT_FALSE(wakes[0].from_sleep);
+  EXPECT_TRUE(wakes[1].from_sleep);
+  EXPECT_EQ(wakes[1].cause, deep_sleep::WAKE_CAUSE_DEFAULT);
+  EXPECT_EQ(wakes[1].at_us, records[0].start_us + 60 * S);
+}
+
+TEST(DeepSleepLifecycle, InvertWakeupArmsTheOppositeLevel) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.sleep_ms = 3600000;
+  config.sleep_when_published = true;
+  config.wakeup_pin = 4;
+  config.wakeup_pin_mode = deep_sleep::WAKEUP_PIN_MODE_INVERT_WAKEUP;
+  SleepSimulator sim(device_factory(config, &trace));
+  FakeGPIOPin *pin = sim.add_pin(4);
+  pin->set_level(true);
+  sim.schedule(600 * S, [pin]() { pin->set_level(false); });
+  sim.run_for_ms(700000);
+
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_GE(records.size(), 1u);
+  EXPECT_EQ(records[0].wakeup_pin, 4);
+  EXPECT_FALSE(records[0].wakeup_level);
+  ASSERT_GE(sim.get_wakes().size(), 2u);
+  EXPECT_EQ(sim.get_wakes()[1].cause, deep_sleep::WAKE_CAUSE_GPIO);
+  EXPECT_EQ(sim.get_wakes()[1].at_us, 600 * S);
+}
+
+TEST(DeepSleepLifecycle, KeepAwakePinDefersSleepUntilRelease) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.run_ms = 5000;
+  config.wakeup_pin = 4;
+  config.wakeup_pin_mode = deep_sleep::WAKEUP_PIN_MODE_KEEP_AWAKE;
+  SleepSimulator sim(device_factory(config, &trace));
+  FakeGPIOPin *pin = sim.add_pin(4);
+  sim.schedule(60 * S, [pin]() { pin->set_level(true); });
+  sim.schedule(90 * S, [pin]() { pin->set_level(false); });
+  sim.run_for_ms(120000);
+
+  const auto &wakes = sim.get_wakes();
+  ASSERT_EQ(wakes.size(), 2u);
+  EXPECT_FALSE(sim.get_hal().get_records()[0].timer_us.has_value());
+  EXPECT_EQ(wakes[1].cause, deep_sleep::WAKE_CAUSE_GPIO);
+  EXPECT_EQ(wakes[1].at_us, 60 * S);
+  ASSERT_TRUE(wakes[1].asleep_us.has_value());
+  EXPECT_GE(*wakes[1].asleep_us, 90 * S);
+  EXPECT_LE(*wakes[1].asleep_us, 90 * S + 2 * LOOP_US);
+  EXPECT_EQ(count_log_lines(ESPHOME_LOG_LEVEL_WARN, "deferring deep sleep"), 1u);
+  EXPECT_FALSE(pin->has_interrupt());
+}
+
+TEST(DeepSleepLifecycle, GpioWakeUsesItsRunDuration) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.run_ms.reset();
+  config.run_by_cause = deep_sleep::WakeupCauseToRunDuration{60000, 60000, 3000};
+  config.sleep_ms = 600000;
+  config.sensor_delay_ms = 0;
+  config.wakeup_pin = 4;
+  SleepSimulator sim(device_factory(config, &trace));
+  FakeGPIOPin *pin = sim.add_pin(4);
+  sim.schedule(120 * S, [pin]() { pin->set_level(true); });
+  sim.schedule(120 * S + 100000, [pin]() { pin->set_level(false); });
+  sim.run_for_ms(130000);
+
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0].awake_ms, 60000u);
+  EXPECT_EQ(sim.get_wakes()[1].cause, deep_sleep::WAKE_CAUSE_GPIO);
+  EXPECT_GE(records[1].awake_ms, 3000u);
+  EXPECT_LE(records[1].awake_ms, 3000u + LOOP_US / 1000);
+}
+
+static DeviceConfig adaptive_config() {
+  DeviceConfig config;
+  config.sleep_when_published = true;
+  config.adaptive = deep_sleep::AdaptiveSleepConfig{60000, 1800000, 5.0f, NAN, 0, NAN, NAN, 0, 0, 0, 0};
+  return config;
+}
+
+TEST(DeepSleepLifecycle, RetainedStateSurvivesSleep) {
+  SleepTrace trace;
+  trace.values = {{0, 500}, {600, 500}, {601, 800}};
+  SleepSimulator sim(device_factory(adaptive_config(), &trace));
+  sim.run_for_ms(1810000);
+
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_EQ(records.size(), 2u);
+  // No previous value on power on; 300 ppm in 30 minutes on the next wake is fast
+  EXPECT_EQ(records[0].timer_us, 1800 * S);
+  EXPECT_EQ(records[1].timer_us, 60 * S);
+}
+
+TEST(DeepSleepLifecycle, PowerCycleDiscardsRetainedState) {
+  SleepTrace trace;
+  trace.values = {{0, 500}, {600, 500}, {601, 800}};
+  SleepSimulator sim(device_factory(adaptive_config(), &trace));
+  sim.run_for_ms(1000000);
+  ASSERT_TRUE(sim.is_asleep());
+  sim.power_cycle();
+  sim.run_for_ms(5000);
+
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_FALSE(sim.get_wakes()[1].from_sleep);
+  EXPECT_EQ(records[1].timer_us, 1800 * S);
+}
+
+TEST(DeepSleepLifecycle, DriftCorrectionLandsWakesOnTheBoundary) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.sleep_ms = 900000;
+  config.sleep_when_published = true;
+  config.sync_ms = 800;
+  config.align_s = 900;
+  config.drift_correction = true;
+  SleepSimulator sim(device_factory(config, &trace));
+  sim.set_timer_drift(1.02);
+  sim.run_for_ms(8 * 3600 * 1000ULL);
+
+  const auto &wakes = sim.get_wakes();
+  ASSERT_GE(wakes.size(), 30u);
+  auto offset_s = [](const WakeRecord &wake) {
+    const int64_t offset = (SLEEP_TRACE_EPOCH * 1000 + static_cast<int64_t>(wake.at_us / 1000)) % 900000;
+    return std::min(offset, 900000 - offset) / 1000.0;
+  };
+  // Uncorrected, the slow clock makes the first timer wake late by 2% of the sleep
+  EXPECT_GT(offset_s(wakes[1]), 15.0);
+  for (size_t i = wakes.size() - 10; i < wakes.size(); i++)
+    EXPECT_LT(offset_s(wakes[i]), 3.0) << "wake " << i;
+}
+
+TEST(DeepSleepLifecycle, MaxHoldBoundsAStuckInhibitor) {
+  SleepTrace trace = constant_trace(500);
+  trace.holds.push_back({0, "stuck", 3600});
+  DeviceConfig config;
+  config.sleep_ms = 300000;
+  config.sleep_when_published = true;
+  config.use_holds = true;
+  config.max_hold_ms = 30000;
+  SleepSimulator sim(device_factory(config, &trace));
+  sim.run_for_ms(60000);
+
+  ASSERT_TRUE(sim.is_asleep());
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_GE(records[0].awake_ms, 30000u);
+  EXPECT_LE(records[0].awake_ms, 30000u + 2 * LOOP_US / 1000);
+  EXPECT_EQ(count_log_lines(ESPHOME_LOG_LEVEL_WARN, "'stuck' exceeded its maximum hold time"), 1u);
+}
+
+TEST(DeepSleepLifecycle, ShutdownReportSurvivesSleep) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.sleep_ms = 60000;
+  config.sleep_when_published = true;
+  // Run in reverse: display overruns the deadline, logger and the sensor after it are skipped, mqtt is critical
+  config.shutdown_hooks = {{"mqtt", 40, true}, {"logger", 30, false}, {"display", 250, false}};
+  config.shutdown_deadline_ms = 100;
+  SleepSimulator sim(device_factory(config, &trace));
+  sim.run_for_ms(3000);
+
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_GE(records[0].awake_ms, 2000u + 250 + 40);
+  EXPECT_LE(records[0].awake_ms, 2000u + 250 + 40 + 2 * LOOP_US / 1000);
+
+  sim.run_for_ms(60000);
+  EXPECT_EQ(count_log_lines(ESPHOME_LOG_LEVEL_DEBUG, "Previous shutdown: "), 1u);
+  EXPECT_EQ(count_log_lines(ESPHOME_LOG_LEVEL_DEBUG, "display 250 ms, mqtt 40 ms, 2 skipped"), 1u);
+}
+
+TEST(DeepSleepLifecycle, ShutdownFollowsSetupPriority) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.sleep_ms = 60000;
+  config.sleep_when_published = true;
+  // Declared before wifi, but set up after it: api has to shut down first, and the deadline then skips wifi and the
+  // sensor
+  config.shutdown_hooks = {{"api", 40, false, 40.0f}, {"wifi", 40, false, 250.0f}};
+  config.shutdown_deadline_ms = 30;
+  SleepSimulator sim(device_factory(config, &trace));
+  sim.run_for_ms(3000);
+  ASSERT_EQ(sim.get_hal().get_records().size(), 1u);
+
+  sim.run_for_ms(60000);
+  EXPECT_EQ(count_log_lines(ESPHOME_LOG_LEVEL_DEBUG, "hooks 40 ms, api 40 ms, 2 skipped"), 1u);
+}
+
+TEST(DeepSleepLifecycle, JournalFlushesEveryNthWake) {
+  SleepTrace trace = constant_trace(500);
+  DeviceConfig config;
+  config.sleep_ms = 60000;
+  config.journal_flush_every = 3;
+  std::vector<uint32_t> ages;
+  config.on_journal_flush = [&ages](float value, uint32_t age_s) { ages.push_back(age_s); };
+  SleepSimulator sim(device_factory(config, &trace));
+  sim.run_for_ms(2 * 61500 + 1000);
+  EXPECT_TRUE(ages.empty());
+
+  sim.run_for_ms(5000);
+  ASSERT_EQ(ages.size(), 3u);
+  // Oldest first, one sleep plus the 1.5 s sample delay apart, in whole seconds
+  EXPECT_EQ(ages[0], 122u);
+  EXPECT_EQ(ages[1], 61u);
+  EXPECT_EQ(ages[2], 0u);
+}
+
+}  // namespace testing
+}  // namespace esphome
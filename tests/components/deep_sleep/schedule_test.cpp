@@ -0,0 +1,130 @@
+// deep_sleep.enter with a wall-clock wake schedule: the sleep armed for a time of day, and a device that follows the
+// schedule over several days.
+
+#include "deep_sleep_firmware.h"
+
+#include <gtest/gtest.h>
+
+namespace esphome {
+namespace testing {
+
+static constexpr uint64_t S = 1000000;
+
+static uint32_t tod(uint32_t hour, uint32_t minute, uint32_t second = 0) { return hour * 3600 + minute * 60 + second; }
+
+// A device without sensors that runs deep_sleep.enter one second after every boot
+struct ScheduledFirmware : DeviceFirmware {
+  struct Enter : Component {
+    explicit Enter(deep_sleep::EnterDeepSleepAction<> *action) : action(action) {}
+    void setup() override {
+      this->set_timeout(1000, [this]() { this->action->play(); });
+    }
+    deep_sleep::EnterDeepSleepAction<> *action;
+  };
+
+  ScheduledFirmware(SleepSimulator &sim, const DeviceConfig &config, const std::vector<uint32_t> &slots)
+      : DeviceFirmware(sim, config, nullptr), action(&this->deep_sleep), enter(&this->action) {
+    this->action.set_schedule(slots.data(), slots.size());
+    this->action.set_time(&this->clock);
+    App.register_component(&this->enter);
+  }
+
+  deep_sleep::EnterDeepSleepAction<> action;
+  Enter enter;
+};
+
+static DeviceConfig scheduled_config(uint32_t sync_ms) {
+  DeviceConfig config;
+  config.run_ms.reset();
+  config.sleep_ms = 600000;
+  config.sensor_delay_ms = 0;
+  config.sync_ms = sync_ms;
+  return config;
+}
+
+static FirmwareFactory scheduled_factory(const DeviceConfig &config, const std::vector<uint32_t> &slots) {
+  return [config, &slots](SleepSimulator &sim) { return std::make_unique<ScheduledFirmware>(sim, config, slots); };
+}
+
+// The sleep armed when deep_sleep.enter runs at `at_s` seconds of the day
+static uint64_t armed_at(const std::vector<uint32_t> &slots, uint32_t at_s) {
+  DeviceConfig config = scheduled_config(0);
+  SleepSimulator sim(scheduled_factory(config, slots));
+  // The action runs one second after boot
+  set_system_time((SLEEP_TRACE_EPOCH + at_s - 1) * static_cast<int64_t>(S));
+  sim.run_for_ms(1500);
+  const auto &records = sim.get_hal().get_records();
+  if (records.size() != 1 || !records[0].timer_us.has_value())
+    return 0;
+  return *records[0].timer_us / S;
+}
+
+TEST(DeepSleepSchedule, SleepsUntilTheNextSlot) {
+  const std::vector<uint32_t> slots = {tod(7, 0), tod(12, 0), tod(18, 30)};
+  EXPECT_EQ(armed_at(slots, tod(6, 0)), 3600u);
+  EXPECT_EQ(armed_at(slots, tod(9, 15, 30)), tod(2, 44, 30));
+  EXPECT_EQ(armed_at(slots, tod(18, 29, 59)), 1u);
+}
+
+TEST(DeepSleepSchedule, SlotNowMeansTheFollowingOne) {
+  const std::vector<uint32_t> slots = {tod(7, 0), tod(12, 0), tod(18, 30)};
+  EXPECT_EQ(armed_at(slots, tod(7, 0)), tod(5, 0));
+  // A single slot: a whole day
+  EXPECT_EQ(armed_at({tod(7, 0)}, tod(7, 0)), 86400u);
+}
+
+TEST(DeepSleepSchedule, WrapsPastMidnight) {
+  const std::vector<uint32_t> slots = {tod(7, 0), tod(12, 0), tod(18, 30)};
+  EXPECT_EQ(armed_at(slots, tod(18, 30, 1)), 86400u - tod(18, 30, 1) + tod(7, 0));
+  EXPECT_EQ(armed_at(slots, tod(23, 59, 59)), tod(7, 0, 1));
+  EXPECT_EQ(armed_at({0}, tod(23, 59, 59)), 1u);
+}
+
+TEST(DeepSleepSchedule, DenseScheduleNeverOverSleeps) {
+  // from 22:00 to 06:00 every 15 minutes, as the codegen expands it
+  std::vector<uint32_t> slots;
+  for (uint32_t t = tod(0, 0); t <= tod(6, 0); t += 900)
+    slots.push_back(t);
+  for (uint32_t t = tod(22, 0); t < 86400; t += 900)
+    slots.push_back(t);
+  for (uint32_t at : {tod(0, 0, 1), tod(3, 7, 12), tod(5, 59, 59), tod(23, 44, 59)}) {
+    const uint64_t armed = armed_at(slots, at);
+    EXPECT_GE(armed, 1u) << at;
+    EXPECT_LE(armed, 900u) << at;
+    EXPECT_EQ((at + armed) % 900, 0u) << at;
+  }
+  // The daytime gap
+  EXPECT_EQ(armed_at(slots, tod(6, 0)), tod(16, 0));
+}
+
+TEST(DeepSleepSchedule, WithoutTheTimeKeepsTheSleepDuration) {
+  const std::vector<uint32_t> slots = {tod(7, 0)};
+  DeviceConfig config = scheduled_config(5000);
+  SleepSimulator sim(scheduled_factory(config, slots));
+  sim.run_for_ms(1500);
+
+  const auto &records = sim.get_hal().get_records();
+  ASSERT_EQ(records.size(), 1u);
+  EXPECT_EQ(records[0].timer_us, 600 * S);
+}
+
+TEST(DeepSleepSchedule, WakesOnEverySlotForDays) {
+  const std::vector<uint32_t> slots = {tod(7, 0), tod(12, 0), tod(18, 30)};
+  DeviceConfig config = scheduled_config(500);
+  SleepSimulator sim(scheduled_factory(config, slots));
+  sim.run_for_ms(3 * 86400 * 1000ULL);
+
+  // Power on at midnight, then three slots a day. The clock is synced in whole seconds, so a wake can land a
+  // second or two late but never early
+  const auto &wakes = sim.get_wakes();
+  ASSERT_EQ(wakes.size(), 1u + 3 * slots.size());
+  for (size_t i = 1; i < wakes.size(); i++) {
+    const uint64_t day_s = (wakes[i].at_us / S) % 86400;
+    EXPECT_GE(day_s, slots[(i - 1) % slots.size()]) << "wake " << i;
+    EXPECT_LE(day_s, slots[(i - 1) % slots.size()] + 2) << "wake " << i;
+    EXPECT_EQ(wakes[i].cause, deep_sleep::WAKE_CAUSE_DEFAULT);
+  }
+}
+
+}  // namespace testing
+}  // namespace esphome
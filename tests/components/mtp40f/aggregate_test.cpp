@@ -0,0 +1,138 @@
+// Windowed CO2 statistics and the median-of-N spike filter in front of them.
+
+#include "mtp40f_harness.h"
+
+#include "esphome/components/mtp40f/mtp40f_aggregate.h"
+
+#include <gtest/gtest.h>
+
+namespace esphome {
+namespace mtp40f {
+
+// Feeds the samples and returns what the spike filter let through, as the window saw it
+static std::vector<uint16_t> filtered(MTP40FAggregator &aggregator, const std::vector<uint32_t> &samples) {
+  std::vector<uint16_t> out;
+  for (uint32_t sample : samples) {
+    aggregator.set_window_size(1);
+    aggregator.add_sample(sample);
+    out.push_back(aggregator.max());
+  }
+  return out;
+}
+
+TEST(MTP40FAggregate, WindowReportsWhenFull) {
+  MTP40FAggregator aggregator;
+  aggregator.set_window_size(4);
+  EXPECT_FALSE(aggregator.add_sample(800));
+  EXPECT_FALSE(aggregator.add_sample(400));
+  EXPECT_FALSE(aggregator.add_sample(1000));
+  EXPECT_TRUE(aggregator.add_sample(600));
+
+  EXPECT_FLOAT_EQ(aggregator.mean(), 700.0f);
+  EXPECT_EQ(aggregator.min(), 400);
+  EXPECT_EQ(aggregator.max(), 1000);
+  // Even count: the upper of the two middle samples
+  EXPECT_EQ(aggregator.median(), 800);
+
+  aggregator.reset();
+  EXPECT_FALSE(aggregator.add_sample(500));
+  EXPECT_FALSE(aggregator.add_sample(500));
+  EXPECT_FALSE(aggregator.add_sample(500));
+  EXPECT_TRUE(aggregator.add_sample(501));
+  EXPECT_EQ(aggregator.min(), 500);
+  EXPECT_EQ(aggregator.max(), 501);
+}
+
+TEST(MTP40FAggregate, MedianOfAnOddWindow) {
+  MTP40FAggregator aggregator;
+  aggregator.set_window_size(5);
+  for (uint32_t ppm : {900u, 410u, 5000u, 420u, 430u})
+    aggregator.add_sample(ppm);
+  EXPECT_EQ(aggregator.median(), 430);
+  // The outlier still shows in the mean and max
+  EXPECT_FLOAT_EQ(aggregator.mean(), 1432.0f);
+  EXPECT_EQ(aggregator.max(), 5000);
+}
+
+TEST(MTP40FAggregate, SizesAreClamped) {
+  MTP40FAggregator aggregator;
+  aggregator.set_window_size(0);
+  EXPECT_EQ(aggregator.get_window_size(), 1);
+  aggregator.set_window_size(200);
+  EXPECT_EQ(aggregator.get_window_size(), MTP40F_AGGREGATE_MAX_WINDOW);
+  aggregator.set_spike_filter_size(0);
+  EXPECT_EQ(aggregator.get_spike_filter_size(), 1);
+  aggregator.set_spike_filter_size(9);
+  EXPECT_EQ(aggregator.get_spike_filter_size(), MTP40F_SPIKE_FILTER_MAX);
+}
+
+TEST(MTP40FAggregate, FullWindowOfTheLargestSize) {
+  MTP40FAggregator aggregator;
+  aggregator.set_window_size(MTP40F_AGGREGATE_MAX_WINDOW);
+  for (uint32_t i = 0; i < MTP40F_AGGREGATE_MAX_WINDOW; i++)
+    EXPECT_EQ(aggregator.add_sample(1000 + i), i + 1 == MTP40F_AGGREGATE_MAX_WINDOW);
+  EXPECT_EQ(aggregator.median(), 1000 + MTP40F_AGGREGATE_MAX_WINDOW / 2);
+  EXPECT_FLOAT_EQ(aggregator.mean(), 1000.0f + (MTP40F_AGGREGATE_MAX_WINDOW - 1) / 2.0f);
+}
+
+TEST(MTP40FAggregate, ReadingsAboveSixteenBitsSaturate) {
+  MTP40FAggregator aggregator;
+  aggregator.set_window_size(1);
+  ASSERT_TRUE(aggregator.add_sample(100000));
+  EXPECT_EQ(aggregator.max(), UINT16_MAX);
+}
+
+TEST(MTP40FAggregate, SpikeFilterDropsASingleOutlier) {
+  MTP40FAggregator aggregator;
+  aggregator.set_spike_filter_size(3);
+  EXPECT_EQ(filtered(aggregator, {500, 510, 4000, 505, 500}), (std::vector<uint16_t>{500, 510, 510, 510, 505}));
+}
+
+TEST(MTP40FAggregate, SpikeFilterFollowsAStepLate) {
+  MTP40FAggregator aggregator;
+  aggregator.set_spike_filter_size(3);
+  // Median of 3: a real change shows up one sample later
+  EXPECT_EQ(filtered(aggregator, {500, 500, 500, 900, 900, 900}),
+            (std::vector<uint16_t>{500, 500, 500, 500, 900, 900}));
+
+  aggregator.set_spike_filter_size(5);
+  // Two outliers in a row still lose to three good samples
+  EXPECT_EQ(filtered(aggregator, {500, 500, 500, 3000, 3000, 500}),
+            (std::vector<uint16_t>{500, 500, 500, 500, 500, 500}));
+}
+
+TEST(MTP40FAggregate, SpikeFilterOfOneIsOff) {
+  MTP40FAggregator aggregator;
+  EXPECT_EQ(filtered(aggregator, {500, 4000, 500}), (std::vector<uint16_t>{500, 4000, 500}));
+}
+
+}  // namespace mtp40f
+
+namespace testing {
+
+TEST(MTP40FAggregate, PublishesOncePerWindow) {
+  MTP40FHarness h;
+  sensor::Sensor median;
+  sensor::Sensor mean;
+  std::vector<float> medians;
+  std::vector<float> means;
+  median.add_on_state_callback([&medians](float state) { medians.push_back(state); });
+  mean.add_on_state_callback([&means](float state) { means.push_back(state); });
+  h.component.set_co2_median_sensor(&median);
+  h.component.set_co2_mean_sensor(&mean);
+  h.component.set_aggregate_window_size(4);
+  h.component.set_aggregate_spike_filter_size(3);
+  h.uart.set_ppm_source([](uint64_t now_us) { return now_us < 30000000 ? 600u : 900u; });
+  h.start();
+  h.run_ms(60000);
+
+  ASSERT_GE(h.published.size(), 8u);
+  EXPECT_EQ(medians.size(), h.published.size() / 4);
+  EXPECT_EQ(means.size(), medians.size());
+  EXPECT_EQ(medians.front(), 600.0f);
+  EXPECT_EQ(means.front(), 600.0f);
+  EXPECT_EQ(medians.back(), 900.0f);
+}
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,98 @@
+// Send-on-delta publishing: absolute and relative thresholds against the last published value, and the heartbeat.
+
+#include "mtp40f_harness.h"
+
+#include <gtest/gtest.h>
+
+namespace esphome {
+namespace mtp40f {
+
+TEST(MTP40FDeadband, UnsetPublishesEverything) {
+  MTP40FDeadband deadband;
+  EXPECT_TRUE(deadband.should_publish(500, 0));
+  EXPECT_TRUE(deadband.should_publish(500, 1));
+  EXPECT_TRUE(deadband.should_publish(500, 2));
+}
+
+TEST(MTP40FDeadband, AbsoluteThresholdIsExclusive) {
+  MTP40FDeadband deadband;
+  deadband.set(20, 0, 0);
+  EXPECT_TRUE(deadband.should_publish(500, 0));
+  EXPECT_FALSE(deadband.should_publish(520, 1000));
+  EXPECT_FALSE(deadband.should_publish(480, 2000));
+  EXPECT_TRUE(deadband.should_publish(521, 3000));
+  EXPECT_TRUE(deadband.should_publish(500, 4000));
+}
+
+TEST(MTP40FDeadband, SlowDriftIsMeasuredFromTheLastPublish) {
+  MTP40FDeadband deadband;
+  deadband.set(20, 0, 0);
+  EXPECT_TRUE(deadband.should_publish(500, 0));
+  EXPECT_FALSE(deadband.should_publish(510, 1000));
+  EXPECT_FALSE(deadband.should_publish(519, 2000));
+  EXPECT_TRUE(deadband.should_publish(521, 3000));
+  EXPECT_FALSE(deadband.should_publish(540, 4000));
+}
+
+TEST(MTP40FDeadband, RelativeThresholdScalesWithTheValue) {
+  MTP40FDeadband deadband;
+  deadband.set(0, 0.02f, 0);
+  EXPECT_TRUE(deadband.should_publish(500, 0));
+  EXPECT_FALSE(deadband.should_publish(509, 1000));
+  EXPECT_TRUE(deadband.should_publish(2000, 2000));
+  // 2% of 2000
+  EXPECT_FALSE(deadband.should_publish(2039, 3000));
+  EXPECT_TRUE(deadband.should_publish(2041, 4000));
+}
+
+TEST(MTP40FDeadband, LargerOfBothThresholdsApplies) {
+  MTP40FDeadband deadband;
+  deadband.set(30, 0.02f, 0);
+  EXPECT_TRUE(deadband.should_publish(500, 0));
+  // 2% would be 10
+  EXPECT_FALSE(deadband.should_publish(525, 1000));
+  EXPECT_TRUE(deadband.should_publish(3000, 2000));
+  // 2% is 60 here
+  EXPECT_FALSE(deadband.should_publish(3050, 3000));
+  EXPECT_TRUE(deadband.should_publish(3061, 4000));
+}
+
+TEST(MTP40FDeadband, HeartbeatRepublishesAnUnchangedValue) {
+  MTP40FDeadband deadband;
+  deadband.set(50, 0, 60000);
+  EXPECT_TRUE(deadband.should_publish(500, 1000));
+  EXPECT_FALSE(deadband.should_publish(500, 60999));
+  EXPECT_TRUE(deadband.should_publish(500, 61000));
+  // A change restarts the heartbeat
+  EXPECT_TRUE(deadband.should_publish(600, 90000));
+  EXPECT_FALSE(deadband.should_publish(600, 149999));
+  EXPECT_TRUE(deadband.should_publish(600, 150000));
+}
+
+TEST(MTP40FDeadband, HeartbeatSurvivesMillisRollover) {
+  MTP40FDeadband deadband;
+  deadband.set(50, 0, 60000);
+  EXPECT_TRUE(deadband.should_publish(500, UINT32_MAX - 10000));
+  EXPECT_FALSE(deadband.should_publish(500, 49998));
+  EXPECT_TRUE(deadband.should_publish(500, 49999));
+}
+
+}  // namespace mtp40f
+
+namespace testing {
+
+TEST(MTP40FDeadband, CO2SensorOnlySeesChangesAndHeartbeats) {
+  MTP40FHarness h;
+  h.component.set_co2_deadband(25, 0, 60000);
+  // Flat for a minute and a half, then a step
+  h.uart.set_ppm_source([](uint64_t now_us) { return now_us < 90000000 ? 600u : 700u; });
+  h.start();
+  h.run_ms(120000);
+
+  ASSERT_GE(h.uart.get_request_count(mtp40f::MTP40FGetGasConcentration::OPCODE), 20u);
+  // First reading, the heartbeat a minute later, the step
+  EXPECT_EQ(h.published, (std::vector<float>{600, 600, 700}));
+}
+
+}  // namespace testing
+}  // namespace esphome
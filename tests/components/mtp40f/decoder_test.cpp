@@ -0,0 +1,137 @@
+// The RX ring buffer decoder: the simulated sensor stays silent and every CO2 request is answered with exactly the
+// bytes the test puts on the line, read one byte time apart as on the wire.
+
+#include "mtp40f_harness.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+
+namespace esphome {
+namespace testing {
+
+static constexpr uint8_t GET_PPM = mtp40f::MTP40FGetGasConcentration::OPCODE;
+static constexpr uint8_t SET_SELF_CALIBRATION = mtp40f::MTP40FSetSelfCalibration::OPCODE;
+
+static std::vector<uint8_t> co2_reply(uint32_t ppm, uint8_t status = 0x00) {
+  const auto frame = mtp40f::mtp40f_build_frame<5>(
+      GET_PPM, {static_cast<uint8_t>(ppm >> 24), static_cast<uint8_t>(ppm >> 16), static_cast<uint8_t>(ppm >> 8),
+                static_cast<uint8_t>(ppm & 0xFF), status});
+  return std::vector<uint8_t>(std::begin(frame.data), std::end(frame.data));
+}
+
+static std::vector<uint8_t> operator+(std::vector<uint8_t> a, const std::vector<uint8_t> &b) {
+  a.insert(a.end(), b.begin(), b.end());
+  return a;
+}
+
+// Bytes to send for the n-th CO2 request
+using Script = std::function<std::vector<uint8_t>(uint32_t poll)>;
+
+static void script_replies(MTP40FHarness &h, Script script) {
+  h.uart.faults().silent = true;
+  auto polls = std::make_shared<uint32_t>(0);
+  h.uart.set_on_request([&h, script, polls](uint8_t opcode) {
+    if (opcode == GET_PPM) {
+      h.uart.inject(script((*polls)++));
+    } else if (opcode == SET_SELF_CALIBRATION) {
+      const auto ack = mtp40f::mtp40f_build_frame<0>(opcode, {});
+      h.uart.inject(std::vector<uint8_t>(std::begin(ack.data), std::end(ack.data)));
+    }
+  });
+}
+
+TEST(MTP40FDecoder, ReassemblesAFrameReadByteByByte) {
+  MTP40FHarness h;
+  script_replies(h, [](uint32_t) { return co2_reply(0x00010203); });
+  h.start();
+  // A 1 ms loop sees every partial frame on the way
+  h.run_ms(6000, 1);
+
+  ASSERT_FALSE(h.published.empty());
+  EXPECT_EQ(h.published.back(), static_cast<float>(0x00010203));
+  EXPECT_EQ(h.component.get_metrics().total_crc_errors(), 0u);
+}
+
+TEST(MTP40FDecoder, SkipsNoiseAndPartialHeaders) {
+  MTP40FHarness h;
+  // A lone 0x42, a header cut short, and a header whose length no reply can have
+  script_replies(h, [](uint32_t) {
+    return std::vector<uint8_t>{0x00, 0x42, 0xFF, 0x42, 0x4D, 0x42, 0x4D, 0xA0, 0x00, 0x03, 0xFF, 0xFF} +
+           co2_reply(655);
+  });
+  h.start();
+  h.run_ms(30000, 1);
+
+  EXPECT_GE(h.published.size(), 5u);
+  EXPECT_EQ(h.published.size(), h.uart.get_request_count(GET_PPM));
+  EXPECT_EQ(h.published.back(), 655.0f);
+  EXPECT_EQ(h.component.get_metrics().total_crc_errors(), 0u);
+}
+
+TEST(MTP40FDecoder, ResyncsAfterABadChecksum) {
+  MTP40FHarness h;
+  script_replies(h, [](uint32_t) {
+    std::vector<uint8_t> bad = co2_reply(999);
+    bad.back() ^= 0x01;
+    return bad + co2_reply(700);
+  });
+  h.start();
+  h.run_ms(30000);
+
+  EXPECT_EQ(h.published.size(), h.uart.get_request_count(GET_PPM));
+  EXPECT_EQ(h.published.back(), 700.0f);
+  EXPECT_EQ(h.component.get_metrics().total_crc_errors(), h.uart.get_request_count(GET_PPM));
+  // The good frame after the bad one clears the error
+  EXPECT_EQ(h.component.get_last_error(), MTP40F_OK);
+  EXPECT_TRUE(h.component.is_link_up());
+}
+
+TEST(MTP40FDecoder, IgnoresRepliesToOtherCommands) {
+  MTP40FHarness h;
+  script_replies(h, [](uint32_t) {
+    const auto pressure = mtp40f::mtp40f_build_frame<2>(mtp40f::MTP40FGetAirPressureReference::OPCODE, {0x03, 0xF5});
+    return std::vector<uint8_t>(std::begin(pressure.data), std::end(pressure.data)) + co2_reply(812);
+  });
+  h.start();
+  h.run_ms(30000);
+
+  EXPECT_EQ(h.published.size(), h.uart.get_request_count(GET_PPM));
+  EXPECT_EQ(h.published.back(), 812.0f);
+}
+
+TEST(MTP40FDecoder, FramesLandAnywhereInTheRingBuffer) {
+  MTP40FHarness h;
+  // 0-6 bytes of noise in front shift each reply to a new offset, so replies wrap around the buffer end
+  script_replies(h, [](uint32_t poll) { return std::vector<uint8_t>(poll % 7, 0x55) + co2_reply(400 + poll); });
+  h.start();
+  h.run_ms(5 * 60 * 1000);
+
+  ASSERT_GE(h.published.size(), 2 * mtp40f::MTP40F_RX_BUFFER_SIZE / 3);
+  for (size_t i = 0; i < h.published.size(); i++)
+    EXPECT_EQ(h.published[i], 400.0f + i) << "poll " << i;
+  EXPECT_EQ(h.component.get_metrics().total_timeouts(), 0u);
+}
+
+TEST(MTP40FDecoder, GarbageLongerThanTheBufferTimesOut) {
+  MTP40FHarness h;
+  script_replies(h, [](uint32_t poll) {
+    if (poll == 0)
+      return std::vector<uint8_t>(3 * mtp40f::MTP40F_RX_BUFFER_SIZE, 0x42);
+    return co2_reply(500);
+  });
+  h.start();
+  // First poll after one update interval
+  h.run_ms(5000 + 1500);
+  EXPECT_TRUE(h.published.empty());
+  EXPECT_EQ(h.component.get_metrics().total_timeouts(), 1u);
+
+  // Nothing of the garbage is left for the next request
+  h.run_ms(30000);
+  ASSERT_FALSE(h.published.empty());
+  EXPECT_EQ(h.published.back(), 500.0f);
+}
+
+}  // namespace testing
+}  // namespace esphome
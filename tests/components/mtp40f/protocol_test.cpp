@@ -0,0 +1,95 @@
+// Frame builder and response views in mtp40f_protocol.h, checked against frames worked out by hand from the datasheet
+// layout: 42 4D A0 | 00 opcode | length (2) | payload | 16-bit sum (2).
+
+#include "esphome/components/mtp40f/mtp40f_protocol.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace esphome {
+namespace mtp40f {
+
+template<size_t N> static std::vector<uint8_t> bytes(const MTP40FFrame<N> &frame) {
+  return std::vector<uint8_t>(frame.data, frame.data + MTP40FFrame<N>::LENGTH);
+}
+
+TEST(MTP40FProtocol, ReadRequestsHaveNoPayload) {
+  EXPECT_EQ(bytes(MTP40FGetGasConcentration::FRAME),
+            (std::vector<uint8_t>{0x42, 0x4D, 0xA0, 0x00, 0x03, 0x00, 0x00, 0x01, 0x32}));
+  EXPECT_EQ(bytes(MTP40FGetAirPressureReference::FRAME),
+            (std::vector<uint8_t>{0x42, 0x4D, 0xA0, 0x00, 0x02, 0x00, 0x00, 0x01, 0x31}));
+  EXPECT_EQ(bytes(MTP40FGetSelfCalibration::FRAME),
+            (std::vector<uint8_t>{0x42, 0x4D, 0xA0, 0x00, 0x07, 0x00, 0x00, 0x01, 0x36}));
+}
+
+TEST(MTP40FProtocol, PayloadIsBigEndianAndSummed) {
+  // 1013 hPa = 0x03F5
+  EXPECT_EQ(bytes(MTP40FSetAirPressureReference::build_for(1013)),
+            (std::vector<uint8_t>{0x42, 0x4D, 0xA0, 0x00, 0x01, 0x00, 0x02, 0x03, 0xF5, 0x02, 0x2A}));
+  // 400 ppm = 0x00000190
+  EXPECT_EQ(bytes(MTP40FSinglePointCorrection::FRAME_400PPM),
+            (std::vector<uint8_t>{0x42, 0x4D, 0xA0, 0x00, 0x04, 0x00, 0x04, 0x00, 0x00, 0x01, 0x90, 0x01, 0xC8}));
+  EXPECT_EQ(bytes(MTP40FSinglePointCorrection::build_for(400)), bytes(MTP40FSinglePointCorrection::FRAME_400PPM));
+  EXPECT_EQ(bytes(MTP40FSetSelfCalibration::FRAME_ENABLE),
+            (std::vector<uint8_t>{0x42, 0x4D, 0xA0, 0x00, 0x06, 0x00, 0x01, 0x00, 0x01, 0x36}));
+  EXPECT_EQ(bytes(MTP40FSetSelfCalibration::FRAME_DISABLE),
+            (std::vector<uint8_t>{0x42, 0x4D, 0xA0, 0x00, 0x06, 0x00, 0x01, 0xFF, 0x02, 0x35}));
+}
+
+TEST(MTP40FProtocol, ChecksumWrapsAtSixteenBits) {
+  const uint8_t data[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  EXPECT_EQ(mtp40f_sum(data, sizeof(data)), 0x07F8);
+  std::vector<uint8_t> ones(300, 0xFF);
+  EXPECT_EQ(mtp40f_sum(ones.data(), ones.size()), static_cast<uint16_t>(300 * 0xFF));
+}
+
+TEST(MTP40FProtocol, LengthsComeFromTheCommand) {
+  EXPECT_EQ(MTP40FGetGasConcentration::REQUEST_LENGTH, 9u);
+  EXPECT_EQ(MTP40FGetGasConcentration::RESPONSE_LENGTH, 14u);
+  EXPECT_EQ(MTP40FGetAirPressureReference::RESPONSE_LENGTH, 11u);
+  EXPECT_EQ(MTP40FSinglePointCorrection::REQUEST_LENGTH, 13u);
+  EXPECT_EQ(MTP40FSinglePointCorrection::RESPONSE_LENGTH, 10u);
+  // Acknowledged without data
+  EXPECT_EQ(MTP40FSetSelfCalibration::RESPONSE_LENGTH, 9u);
+  // Not acknowledged at all
+  EXPECT_EQ(MTP40FSetAirPressureReference::RESPONSE_LENGTH, 0u);
+}
+
+TEST(MTP40FProtocol, RxBufferHoldsTwoLongestReplies) {
+  EXPECT_EQ(mtp40f_next_power_of_two(1), 1u);
+  EXPECT_EQ(mtp40f_next_power_of_two(28), 32u);
+  EXPECT_EQ(mtp40f_next_power_of_two(32), 32u);
+  EXPECT_GE(MTP40F_RX_BUFFER_SIZE, 2 * MTP40FGetGasConcentration::RESPONSE_LENGTH);
+}
+
+// Writes a reply into a ring buffer of the component's size starting at `start`, wrapping at the end
+template<size_t N> static MTP40FFrameView place(uint8_t (&ring)[MTP40F_RX_BUFFER_SIZE], size_t start,
+                                                const MTP40FFrame<N> &frame) {
+  for (size_t i = 0; i < MTP40FFrame<N>::LENGTH; i++)
+    ring[(start + i) & MTP40F_RX_BUFFER_MASK] = frame.data[i];
+  return MTP40FFrameView(ring, start, MTP40FFrame<N>::LENGTH);
+}
+
+TEST(MTP40FProtocol, DecodesRepliesAcrossTheRingBufferEnd) {
+  uint8_t ring[MTP40F_RX_BUFFER_SIZE] = {};
+  const auto reply = mtp40f_build_frame<5>(MTP40FGetGasConcentration::OPCODE, {0x00, 0x01, 0x02, 0x03, 0x00});
+  for (size_t start = 0; start < MTP40F_RX_BUFFER_SIZE; start++) {
+    const MTP40FFrameView view = place(ring, start, reply);
+    EXPECT_EQ(view.command(), MTP40FGetGasConcentration::OPCODE);
+    EXPECT_EQ(view.payload_length(), 5u);
+    const auto response = MTP40FGetGasConcentration::decode(view);
+    EXPECT_EQ(response.ppm, 0x00010203u) << "start " << start;
+    EXPECT_EQ(response.status, 0x00);
+  }
+
+  const auto pressure_reply = mtp40f_build_frame<2>(MTP40FGetAirPressureReference::OPCODE, {0x03, 0xF5});
+  const MTP40FFrameView pressure = place(ring, MTP40F_RX_BUFFER_SIZE - 8, pressure_reply);
+  EXPECT_EQ(MTP40FGetAirPressureReference::decode(pressure), 1013);
+  const MTP40FFrameView calibration =
+      place(ring, MTP40F_RX_BUFFER_SIZE - 1, mtp40f_build_frame<1>(MTP40FGetSelfCalibration::OPCODE, {0xFF}));
+  EXPECT_EQ(MTP40FGetSelfCalibration::decode(calibration), 0xFF);
+}
+
+}  // namespace mtp40f
+}  // namespace esphome
@@ -0,0 +1,50 @@
+// Warm-up after a power cycle: nothing the sensor answers to a request from before the cycle may end the warm-up.
+
+#include "mtp40f_harness.h"
+
+#include <gtest/gtest.h>
+
+namespace esphome {
+namespace testing {
+
+static constexpr uint8_t GET_PPM = mtp40f::MTP40FGetGasConcentration::OPCODE;
+
+TEST(MTP40FReadiness, PowerCycleWithAReadPendingStaysNotReady) {
+  MTP40FHarness h;
+  FakeGPIOPin power(4);
+  h.uart.set_power_pin(&power);
+  h.component.set_power_pin(&power);
+  h.component.set_power_cycle_after(1);
+  h.component.set_warmup_seconds(20);
+  // Answers CO2 and the setup commands, but never the self-calibration status read
+  h.uart.faults().silent = true;
+  h.uart.set_on_request([&h](uint8_t opcode) {
+    if (opcode == GET_PPM) {
+      const auto reply = mtp40f::mtp40f_build_frame<5>(GET_PPM, {0x00, 0x00, 0x02, 0x58, 0x00});
+      h.uart.inject(std::vector<uint8_t>(std::begin(reply.data), std::end(reply.data)));
+    } else if (opcode == mtp40f::MTP40FSetSelfCalibration::OPCODE) {
+      const auto ack = mtp40f::mtp40f_build_frame<0>(opcode, {});
+      h.uart.inject(std::vector<uint8_t>(std::begin(ack.data), std::end(ack.data)));
+    }
+  });
+
+  h.start();
+  h.run_ms(24500);
+  ASSERT_TRUE(h.component.is_ready());
+  ASSERT_EQ(h.published, (std::vector<float>{600}));
+
+  // The poll at 25 s queues a CO2 read behind the status read, whose timeout then power cycles the sensor
+  h.component.read_self_calibration_status();
+  h.run_ms(10000);
+  EXPECT_EQ(count_log_lines(ESPHOME_LOG_LEVEL_WARN, "Power cycling MTP40F"), 1u);
+  EXPECT_FALSE(h.component.is_ready());
+  EXPECT_EQ(h.published.size(), 1u);
+
+  // A full warm-up after the power came back at 26.5 s, up to the first poll after it
+  h.run_ms(20000);
+  EXPECT_TRUE(h.component.is_ready());
+  EXPECT_EQ(h.published.size(), 2u);
+}
+
+}  // namespace testing
+}  // namespace esphome
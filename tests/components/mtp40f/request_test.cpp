@@ -0,0 +1,99 @@
+// Request/response path through the simulated UART: setup(), update() and loop() as the main loop calls them.
+
+#include "mtp40f_harness.h"
+
+#include <gtest/gtest.h>
+
+namespace esphome {
+namespace testing {
+
+static constexpr uint8_t GET_PPM = mtp40f::MTP40FGetGasConcentration::OPCODE;
+
+TEST(MTP40FRequest, CleanLinkPublishesEveryPoll) {
+  MTP40FHarness h;
+  h.uart.set_ppm(812);
+  h.start();
+  h.run_ms(60000, 1);
+
+  EXPECT_GE(h.uart.get_request_count(GET_PPM), 11u);
+  EXPECT_EQ(h.published.size(), h.uart.get_request_count(GET_PPM));
+  EXPECT_EQ(h.published.back(), 812.0f);
+  EXPECT_EQ(h.component.get_metrics().total_timeouts(), 0u);
+  EXPECT_EQ(h.uart.get_bad_request_count(), 0u);
+  EXPECT_EQ(blocked_us(), 0u);
+}
+
+TEST(MTP40FRequest, SetupAppliesSelfCalibration) {
+  MTP40FHarness h;
+  h.component.set_self_calibration_enabled(false);
+  h.start();
+  h.run_ms(1000);
+
+  EXPECT_EQ(h.uart.get_request_count(mtp40f::MTP40FSetSelfCalibration::OPCODE), 1u);
+  EXPECT_FALSE(h.uart.get_self_calibration());
+}
+
+TEST(MTP40FRequest, ReplyAfterTimeoutIsCountedOnce) {
+  MTP40FHarness h;
+  h.uart.faults().latency_ms = 1500;
+  h.start();
+  h.run_ms(1200);
+
+  EXPECT_TRUE(h.published.empty());
+  EXPECT_EQ(h.component.get_metrics().total_timeouts(), 1u);
+  EXPECT_FALSE(h.component.is_link_up());
+}
+
+TEST(MTP40FRequest, SilentSensorBacksOff) {
+  MTP40FHarness h;
+  h.uart.faults().silent = true;
+  std::vector<uint64_t> requests;
+  h.uart.set_on_request([&requests](uint8_t opcode) { requests.push_back(now_us() / 1000); });
+  h.start();
+  h.run_ms(10 * 60 * 1000);
+
+  // 2 s, 4 s, 8 s ... between attempts instead of every poll
+  ASSERT_GE(requests.size(), 5u);
+  EXPECT_LT(requests.size(), 20u);
+  for (size_t i = 2; i < requests.size(); i++)
+    EXPECT_GE(requests[i] - requests[i - 1], requests[i - 1] - requests[i - 2]) << "attempt " << i;
+  EXPECT_TRUE(h.published.empty());
+}
+
+TEST(MTP40FRequest, NoiseBeforeReplyIsSkipped) {
+  MTP40FHarness h;
+  h.uart.faults().noise_rate = 1.0f;
+  h.start();
+  h.run_ms(30000);
+
+  EXPECT_GE(h.published.size(), 5u);
+  EXPECT_EQ(h.published.size(), h.uart.get_request_count(GET_PPM));
+}
+
+TEST(MTP40FRequest, CorruptRepliesAreNotPublished) {
+  MTP40FHarness h;
+  h.uart.faults().corrupt_rate = 1.0f;
+  h.start();
+  h.run_ms(5 * 60 * 1000);
+
+  const auto &metrics = h.component.get_metrics();
+  EXPECT_TRUE(h.published.empty());
+  EXPECT_GT(metrics.total_crc_errors() + metrics.total_timeouts(), 0u);
+  EXPECT_EQ(metrics.total_success(), 0u);
+}
+
+TEST(MTP40FRequest, RecoversWhenTheLineClears) {
+  MTP40FHarness h;
+  h.uart.faults().drop_rate = 1.0f;
+  h.start();
+  h.run_ms(20000);
+  ASSERT_FALSE(h.component.is_link_up());
+
+  h.uart.faults().drop_rate = 0.0f;
+  h.run_ms(60000);
+  EXPECT_TRUE(h.component.is_link_up());
+  EXPECT_FALSE(h.published.empty());
+}
+
+}  // namespace testing
+}  // namespace esphome
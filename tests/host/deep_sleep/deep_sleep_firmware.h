@@ -0,0 +1,193 @@
+#pragma once
+
+#include "sleep_simulator.h"
+#include "sleep_trace.h"
+
+#include "esphome/components/deep_sleep/deep_sleep_component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/time/real_time_clock.h"
+#include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace testing {
+
+/// Publishes the trace value once per boot, `delay_ms` after setup, like a sensor that needs a measurement cycle.
+class TraceSensor : public sensor::Sensor, public Component {
+ public:
+  TraceSensor(const SleepTrace *trace, uint32_t delay_ms)
+      : sensor::Sensor("Trace"), trace_(trace), delay_ms_(delay_ms) {}
+  void setup() override {
+    this->set_timeout(this->delay_ms_, [this]() { this->publish_state(this->trace_->value_at(now_us() / 1e6)); });
+  }
+  float get_setup_priority() const override { return setup_priority::DATA; }
+
+ protected:
+  const SleepTrace *trace_;
+  uint32_t delay_ms_;
+};
+
+/// A time source that receives the true time `sync_ms` after boot, like SNTP once the network is up.
+class SyncedClock : public time::RealTimeClock {
+ public:
+  explicit SyncedClock(uint32_t sync_ms) : sync_ms_(sync_ms) {}
+  void setup() override {
+    this->set_timeout(this->sync_ms_, [this]() {
+      this->synchronize_epoch_(SLEEP_TRACE_EPOCH + static_cast<uint32_t>(now_us() / 1000000));
+    });
+  }
+  float get_setup_priority() const override { return setup_priority::AFTER_CONNECTION; }
+
+ protected:
+  uint32_t sync_ms_;
+};
+
+/// Holds a sleep inhibitor while the device is awake inside one of the trace's hold windows.
+class HoldDriver : public Component {
+ public:
+  HoldDriver(deep_sleep::DeepSleepComponent *deep_sleep, const SleepTrace *trace, uint32_t max_hold_ms)
+      : deep_sleep_(deep_sleep), trace_(trace), max_hold_ms_(max_hold_ms) {}
+  void setup() override { this->loop(); }
+  void loop() override {
+    const double t_s = now_us() / 1e6;
+    std::map<std::string, bool> active;
+    for (const auto &hold : this->trace_->holds)
+      active[hold.name] |= t_s >= hold.t_s && t_s < hold.t_s + hold.duration_s;
+    for (const auto &it : active) {
+      bool &held = this->held_[it.first];
+      if (it.second && !held) {
+        this->deep_sleep_->prevent_deep_sleep(it.first, this->max_hold_ms_);
+      } else if (!it.second && held) {
+        this->deep_sleep_->allow_deep_sleep(it.first);
+      }
+      held = it.second;
+    }
+  }
+  float get_setup_priority() const override { return setup_priority::DATA; }
+
+ protected:
+  deep_sleep::DeepSleepComponent *deep_sleep_;
+  const SleepTrace *trace_;
+  uint32_t max_hold_ms_;
+  std::map<std::string, bool> held_;
+};
+
+/// A component whose shutdown hook takes `duration_ms`.
+class SlowShutdown : public Component {
+ public:
+  SlowShutdown(uint32_t duration_ms, float setup_priority)
+      : duration_ms_(duration_ms), setup_priority_(setup_priority) {}
+  float get_setup_priority() const override { return this->setup_priority_; }
+  void on_safe_shutdown() override {
+    delay(this->duration_ms_);
+    this->calls++;
+  }
+  uint32_t calls{0};
+
+ protected:
+  uint32_t duration_ms_;
+  float setup_priority_;
+};
+
+/// How one simulated device is configured, mirroring the deep_sleep YAML options.
+struct DeviceConfig {
+  optional<uint32_t> run_ms{10000};
+  optional<uint32_t> sleep_ms;
+  /// 0 = no sensor
+  uint32_t sensor_delay_ms{1500};
+  bool sleep_when_published{false};
+  uint32_t grace_ms{500};
+  optional<deep_sleep::AdaptiveSleepConfig> adaptive;
+  /// 0 = no time source
+  uint32_t sync_ms{0};
+  uint32_t align_s{0};
+  bool drift_correction{false};
+  int wakeup_pin{-1};
+  deep_sleep::WakeupPinMode wakeup_pin_mode{deep_sleep::WAKEUP_PIN_MODE_IGNORE};
+  optional<deep_sleep::WakeupCauseToRunDuration> run_by_cause;
+  /// Acquire the trace's hold windows as inhibitors
+  bool use_holds{false};
+  uint32_t max_hold_ms{0};
+  uint8_t journal_flush_every{0};
+  std::function<void(float value, uint32_t age_s)> on_journal_flush;
+  struct Hook {
+    const char *name;
+    uint32_t duration_ms;
+    bool critical;
+    float setup_priority{0.0f};
+  };
+  std::vector<Hook> shutdown_hooks;
+  uint32_t shutdown_deadline_ms{0};
+};
+
+/// One boot of a device built from a DeviceConfig, wired the way the generated code does it.
+struct DeviceFirmware : Firmware {
+  DeviceFirmware(SleepSimulator &sim, const DeviceConfig &config, const SleepTrace *trace)
+      : sensor(trace, config.sensor_delay_ms), clock(config.sync_ms), holds(&deep_sleep, trace, config.max_hold_ms) {
+    if (config.run_ms.has_value())
+      this->deep_sleep.set_run_duration(*config.run_ms);
+    if (config.run_by_cause.has_value())
+      this->deep_sleep.set_run_duration(*config.run_by_cause);
+    if (config.sleep_ms.has_value())
+      this->deep_sleep.set_sleep_duration(*config.sleep_ms);
+    if (config.wakeup_pin >= 0) {
+      this->deep_sleep.set_wakeup_pin(sim.get_pin(config.wakeup_pin));
+      this->deep_sleep.set_wakeup_pin_mode(config.wakeup_pin_mode);
+    }
+    if (config.sensor_delay_ms != 0) {
+      App.register_component(&this->sensor);
+      App.register_sensor(&this->sensor);
+      if (config.sleep_when_published) {
+        this->deep_sleep.add_required_sensor(&this->sensor);
+        this->deep_sleep.set_publish_grace_delay(config.grace_ms);
+      }
+      if (config.adaptive.has_value())
+        this->deep_sleep.set_adaptive_sleep(&this->sensor, *config.adaptive);
+      if (config.journal_flush_every != 0) {
+        this->deep_sleep.set_journal(&this->sensor, config.journal_flush_every);
+        this->deep_sleep.add_journal_flush_trigger(&this->journal_flush);
+        if (config.on_journal_flush)
+          this->journal_flush.add_callback(
+              [config](float value, uint32_t age_s, uint8_t cause) { config.on_journal_flush(value, age_s); });
+      }
+    }
+    if (config.sync_ms != 0) {
+      App.register_component(&this->clock);
+      this->deep_sleep.set_time(&this->clock);
+      this->deep_sleep.set_align_to(config.align_s);
+      this->deep_sleep.set_drift_correction(config.drift_correction);
+    }
+    if (config.use_holds)
+      App.register_component(&this->holds);
+    for (const auto &hook : config.shutdown_hooks) {
+      this->slow.push_back(std::make_unique<SlowShutdown>(hook.duration_ms, hook.setup_priority));
+      this->slow.back()->set_component_source(hook.name);
+      App.register_component(this->slow.back().get());
+      if (hook.critical)
+        this->deep_sleep.add_critical_shutdown_component(this->slow.back().get());
+    }
+    this->deep_sleep.set_shutdown_deadline(config.shutdown_deadline_ms);
+    App.register_component(&this->deep_sleep);
+  }
+
+  TraceSensor sensor;
+  SyncedClock clock;
+  deep_sleep::DeepSleepComponent deep_sleep;
+  HoldDriver holds;
+  deep_sleep::JournalFlushTrigger journal_flush;
+  std::vector<std::unique_ptr<SlowShutdown>> slow;
+};
+
+inline FirmwareFactory device_factory(const DeviceConfig &config, const SleepTrace *trace) {
+  return [config, trace](SleepSimulator &sim) { return std::make_unique<DeviceFirmware>(sim, config, trace); };
+}
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,314 @@
+// Replays multi-day wake/sleep traces against DeepSleepComponent on the simulated clock and reports how long the
+// device was awake and how many deadlines it missed. Exits non-zero if a scenario misses its expectations.
+//
+//   deep_sleep_scenarios [--days N] [--trace file.csv] [--scenario name]
+//
+// Without --trace every scenario replays SleepTrace::synthetic(); see sleep_trace.h for the file format.
+
+#include "deep_sleep_firmware.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::testing;
+
+namespace {
+
+/// What counts as a missed deadline; zero fields are not checked.
+struct Deadlines {
+  uint64_t max_gap_ms{0};    ///< From one wake to the next (or to the end of the run)
+  uint64_t max_awake_ms{0};  ///< From a wake until the device sleeps again
+  uint32_t align_s{0};       ///< Timer wakes must land on multiples of this, in UTC ...
+  uint32_t align_tolerance_ms{0};  ///< ... give or take this much
+  float max_change{0};       ///< Sensor change between consecutive wakes, i.e. a change the device slept through
+  bool presses{false};       ///< Awake within a loop of each press, asleep soon after the release
+  uint32_t press_run_ms{0};  ///< Run duration after a wake by the pin
+};
+
+struct Expectations {
+  uint32_t min_wakes{0};
+  uint32_t max_wakes{UINT32_MAX};
+  uint32_t min_missed{0};
+  uint32_t max_missed{0};
+  double max_awake_percent{100.0};
+  uint32_t min_forced_releases{0};
+};
+
+struct Scenario {
+  const char *name;
+  DeviceConfig config;
+  double timer_drift;
+  Deadlines deadlines;
+  Expectations expect;
+};
+
+struct Missed {
+  uint32_t gap{0};
+  uint32_t awake{0};
+  uint32_t align{0};
+  uint32_t change{0};
+  uint32_t press{0};
+  uint32_t total() const { return this->gap + this->awake + this->align + this->change + this->press; }
+};
+
+struct Result {
+  uint32_t wakes{0};
+  uint32_t timer_wakes{0};
+  uint32_t pin_wakes{0};
+  uint64_t awake_us{0};
+  uint64_t total_us{0};
+  double awake_p50_s{0};
+  double awake_max_s{0};
+  double max_gap_s{0};
+  uint32_t forced_releases{0};
+  Missed missed;
+};
+
+const uint32_t LOOP_MS = 16;
+
+std::vector<Scenario> scenarios(uint32_t days) {
+  std::vector<Scenario> list;
+  const uint32_t day_wakes = days * 86400 / 300;
+
+  {
+    // Fixed 5 minute period, sleeping as soon as the reading is out; shutdown hooks bounded by a deadline
+    Scenario s{"fixed", {}, 1.0, {}, {}};
+    s.config.sleep_ms = 300000;
+    s.config.sleep_when_published = true;
+    s.config.shutdown_hooks = {{"mqtt", 40, true}, {"display", 250, false}, {"logger", 30, false}};
+    s.config.shutdown_deadline_ms = 200;
+    s.deadlines.max_gap_ms = 300000 + 15000;
+    s.deadlines.max_awake_ms = 10000 + 500;
+    s.expect = {day_wakes * 95 / 100, day_wakes + 1, 0, 0, 1.0, 0};
+    list.push_back(s);
+  }
+  {
+    // Adaptive sleep between 1 and 30 minutes from the CO2 trend
+    Scenario s{"adaptive", {}, 1.0, {}, {}};
+    s.config.sleep_ms = 300000;
+    s.config.sleep_when_published = true;
+    s.config.adaptive = deep_sleep::AdaptiveSleepConfig{60000, 1800000, 5.0f, 1400.0f, 50.0f, NAN, NAN, 0, 0, 80.0f,
+                                                         0.01f};
+    s.deadlines.max_gap_ms = 1800000 + 15000;
+    s.deadlines.max_awake_ms = 10000 + 500;
+    s.deadlines.max_change = 250.0f;
+    // Far fewer wakes than the fixed period, but the airing at noon starts while asleep
+    s.expect = {days * 48, day_wakes * 3 / 4, 0, days, 1.0, 0};
+    list.push_back(s);
+  }
+  {
+    // Quarter-hour wakes on a slow clock that runs 2% long, corrected from the SNTP time
+    Scenario s{"aligned", {}, 1.02, {}, {}};
+    s.config.sleep_ms = 900000;
+    s.config.sleep_when_published = true;
+    s.config.sync_ms = 800;
+    s.config.align_s = 900;
+    s.config.drift_correction = true;
+    s.deadlines.max_gap_ms = 900000 + 20000;
+    s.deadlines.align_s = 900;
+    s.deadlines.align_tolerance_ms = 5000;
+    s.expect = {days * 96 * 95 / 100, days * 96 + 1, 0, 4, 1.0, 0};
+    list.push_back(s);
+  }
+  {
+    // Same without drift correction: every timer wake lands about 18 s late
+    Scenario s = list.back();
+    s.name = "aligned, no drift correction";
+    s.config.drift_correction = false;
+    s.expect = {days * 96 * 95 / 100, days * 96 + 1, days * 96 * 9 / 10, UINT32_MAX, 1.0, 0};
+    list.push_back(s);
+  }
+  {
+    // No timer: sleep until the button, stay awake while it is held
+    Scenario s{"wakeup pin", {}, 1.0, {}, {}};
+    s.config.run_ms = 5000;
+    s.config.wakeup_pin = 4;
+    s.config.wakeup_pin_mode = deep_sleep::WAKEUP_PIN_MODE_KEEP_AWAKE;
+    s.deadlines.presses = true;
+    s.deadlines.press_run_ms = 5000;
+    s.expect = {days * 2 + 1, days * 2 + 1, 0, 0, 100.0, 0};
+    list.push_back(s);
+  }
+  {
+    // OTA holds and a holder that never lets go, bounded by max_hold
+    Scenario s{"inhibitors", {}, 1.0, {}, {}};
+    s.config.sleep_ms = 300000;
+    s.config.sleep_when_published = true;
+    s.config.use_holds = true;
+    s.config.max_hold_ms = 60000;
+    s.deadlines.max_gap_ms = 300000 + 60000 + 15000;
+    s.deadlines.max_awake_ms = 60000 + 10000 + 500;
+    s.expect = {day_wakes * 80 / 100, day_wakes + 1, 0, 0, 2.0, 1};
+    list.push_back(s);
+  }
+  return list;
+}
+
+double percentile(std::vector<double> values, double p) {
+  if (values.empty())
+    return 0;
+  std::sort(values.begin(), values.end());
+  size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+  return values[std::min(std::max<size_t>(rank, 1), values.size()) - 1];
+}
+
+Result run(const Scenario &scenario, const SleepTrace &trace, uint32_t days) {
+  SleepSimulator sim(device_factory(scenario.config, &trace));
+  sim.set_timer_drift(scenario.timer_drift);
+  sim.set_loop_interval(LOOP_MS);
+  if (scenario.config.wakeup_pin >= 0) {
+    FakeGPIOPin *pin = sim.add_pin(scenario.config.wakeup_pin);
+    for (const auto &press : trace.presses) {
+      const uint64_t at_us = static_cast<uint64_t>(press.t_s * 1e6);
+      sim.schedule(at_us, [pin]() { pin->set_level(true); });
+      sim.schedule(at_us + static_cast<uint64_t>(press.duration_s * 1e6), [pin]() { pin->set_level(false); });
+    }
+  }
+  const uint64_t end_us = days * 86400ULL * 1000000ULL;
+  sim.run_until(end_us);
+
+  Result result;
+  result.total_us = end_us;
+  const auto &wakes = sim.get_wakes();
+  const Deadlines &d = scenario.deadlines;
+  std::vector<double> awake_s;
+  for (size_t i = 0; i < wakes.size(); i++) {
+    const WakeRecord &wake = wakes[i];
+    result.wakes++;
+    if (wake.from_sleep && wake.cause == deep_sleep::WAKE_CAUSE_GPIO) {
+      result.pin_wakes++;
+    } else if (wake.from_sleep) {
+      result.timer_wakes++;
+    }
+    const uint64_t asleep_us = wake.asleep_us.value_or(end_us);
+    const uint64_t awake = asleep_us - wake.at_us;
+    result.awake_us += awake;
+    awake_s.push_back(awake / 1e6);
+    if (d.max_awake_ms != 0 && awake > d.max_awake_ms * 1000)
+      result.missed.awake++;
+
+    const uint64_t next_us = i + 1 < wakes.size() ? wakes[i + 1].at_us : end_us;
+    result.max_gap_s = std::max(result.max_gap_s, (next_us - wake.at_us) / 1e6);
+    if (d.max_gap_ms != 0 && next_us - wake.at_us > d.max_gap_ms * 1000)
+      result.missed.gap++;
+
+    if (d.align_s != 0 && wake.from_sleep && wake.cause == deep_sleep::WAKE_CAUSE_DEFAULT) {
+      const int64_t period_ms = d.align_s * 1000LL;
+      const int64_t offset_ms = (SLEEP_TRACE_EPOCH * 1000LL + static_cast<int64_t>(wake.at_us / 1000)) % period_ms;
+      if (std::min(offset_ms, period_ms - offset_ms) > d.align_tolerance_ms)
+        result.missed.align++;
+    }
+    if (d.max_change > 0 && i + 1 < wakes.size()) {
+      const float before = trace.value_at(wake.at_us / 1e6);
+      const float after = trace.value_at(wakes[i + 1].at_us / 1e6);
+      if (std::fabs(after - before) > d.max_change)
+        result.missed.change++;
+    }
+  }
+  if (d.presses) {
+    for (const auto &press : trace.presses) {
+      const uint64_t at_us = static_cast<uint64_t>(press.t_s * 1e6);
+      const uint64_t release_us = at_us + static_cast<uint64_t>(press.duration_s * 1e6);
+      if (release_us >= end_us)
+        continue;
+      // The boot that was awake while the button went down
+      auto it = std::find_if(wakes.begin(), wakes.end(), [at_us, end_us](const WakeRecord &wake) {
+        return wake.at_us <= at_us + LOOP_MS * 1000 && wake.asleep_us.value_or(end_us) > at_us;
+      });
+      if (it == wakes.end()) {
+        result.missed.press++;
+        continue;
+      }
+      const uint64_t asleep_us = it->asleep_us.value_or(end_us);
+      const uint64_t allowed_us =
+          std::max<uint64_t>(release_us, it->at_us + d.press_run_ms * 1000ULL) + 2 * LOOP_MS * 1000;
+      if (asleep_us < release_us || asleep_us > allowed_us)
+        result.missed.press++;
+    }
+  }
+  result.awake_p50_s = percentile(awake_s, 50);
+  result.awake_max_s = percentile(awake_s, 100);
+  result.forced_releases = count_log_lines(ESPHOME_LOG_LEVEL_WARN, "exceeded its maximum hold time");
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint32_t days = 3;
+  std::string trace_path;
+  std::string only;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "--days") == 0) {
+      days = std::max<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10), 1);
+    } else if (std::strcmp(argv[i], "--trace") == 0) {
+      trace_path = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--scenario") == 0) {
+      only = argv[i + 1];
+    } else {
+      std::fprintf(stderr, "usage: %s [--days N] [--trace file.csv] [--scenario name]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (argc % 2 == 0) {
+    std::fprintf(stderr, "usage: %s [--days N] [--trace file.csv] [--scenario name]\n", argv[0]);
+    return 2;
+  }
+
+  SleepTrace trace = SleepTrace::synthetic(days);
+  if (!trace_path.empty()) {
+    std::string error;
+    if (!trace.load(trace_path, &error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 2;
+    }
+  }
+
+  std::printf("deep_sleep scenarios: %u simulated days, trace %s\n\n", days,
+              trace_path.empty() ? "synthetic" : trace_path.c_str());
+  std::printf("%-28s %6s %6s %4s | %8s %6s | %-16s | %8s | %-27s\n", "scenario", "wakes", "timer", "pin", "awake h",
+              "awake", "awake s p50/max", "gap max", "missed gap/awk/aln/chg/prs");
+
+  int failures = 0;
+  int ran = 0;
+  for (const auto &scenario : scenarios(days)) {
+    if (!only.empty() && only != scenario.name)
+      continue;
+    ran++;
+    const Result r = run(scenario, trace, days);
+    const double awake_percent = 100.0 * r.awake_us / r.total_us;
+    const Missed &m = r.missed;
+    std::printf("%-28s %6u %6u %4u | %8.2f %5.2f%% | %7.1f %8.1f | %7.0fs | %5u = %u/%u/%u/%u/%u\n", scenario.name,
+                r.wakes, r.timer_wakes, r.pin_wakes, r.awake_us / 3.6e9, awake_percent, r.awake_p50_s, r.awake_max_s,
+                r.max_gap_s, m.total(), m.gap, m.awake, m.align, m.change, m.press);
+
+    const Expectations &e = scenario.expect;
+    auto fail = [&failures](const char *what, double value) {
+      std::printf("  FAIL: %s (%.2f)\n", what, value);
+      failures++;
+    };
+    if (r.wakes < e.min_wakes)
+      fail("too few wakes", r.wakes);
+    if (r.wakes > e.max_wakes)
+      fail("too many wakes", r.wakes);
+    if (m.total() < e.min_missed)
+      fail("fewer missed deadlines than expected", m.total());
+    if (m.total() > e.max_missed)
+      fail("missed deadlines", m.total());
+    if (awake_percent > e.max_awake_percent)
+      fail("awake too long", awake_percent);
+    if (r.forced_releases < e.min_forced_releases)
+      fail("stuck inhibitor never released", r.forced_releases);
+  }
+  if (ran == 0) {
+    std::fprintf(stderr, "no scenario named '%s'\n", only.c_str());
+    return 2;
+  }
+  return failures == 0 ? 0 : 1;
+}
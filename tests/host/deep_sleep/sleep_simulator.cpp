@@ -0,0 +1,139 @@
+#include "sleep_simulator.h"
+
+#include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace esphome {
+namespace testing {
+
+void RecordingSleepHal::deep_sleep(const deep_sleep::HostSleepRequest &request) {
+  this->records_.push_back({now_us(), millis(), request.sleep_duration_us,
+                            request.wakeup_pin != nullptr ? request.wakeup_pin->get_pin() : -1, request.wakeup_level});
+  this->asleep_ = true;
+  halt();
+}
+
+SleepSimulator::SleepSimulator(FirmwareFactory factory) : factory_(std::move(factory)) { reset(); }
+
+SleepSimulator::~SleepSimulator() {
+  // App must not keep pointers into the firmware
+  reboot();
+  this->firmware_.reset();
+}
+
+FakeGPIOPin *SleepSimulator::add_pin(uint8_t pin, bool inverted) {
+  auto &slot = this->pins_[pin];
+  slot = std::make_unique<FakeGPIOPin>(pin, inverted);
+  return slot.get();
+}
+
+FakeGPIOPin *SleepSimulator::get_pin(uint8_t pin) {
+  auto it = this->pins_.find(pin);
+  return it == this->pins_.end() ? nullptr : it->second.get();
+}
+
+void SleepSimulator::schedule(uint64_t at_us, std::function<void()> &&event) {
+  this->events_.emplace(at_us, std::move(event));
+}
+
+void SleepSimulator::run_until(uint64_t end_us) {
+  if (!this->powered_) {
+    this->powered_ = true;
+    this->boot_(false, deep_sleep::WAKE_CAUSE_DEFAULT);
+  }
+  while (now_us() < end_us) {
+    if (this->hal_.is_asleep()) {
+      this->run_asleep_(end_us);
+    } else {
+      this->run_awake_(end_us);
+    }
+  }
+}
+
+void SleepSimulator::power_cycle() {
+  this->powered_ = true;
+  this->boot_(false, deep_sleep::WAKE_CAUSE_DEFAULT);
+}
+
+void SleepSimulator::boot_(bool from_sleep, deep_sleep::WakeCause cause) {
+  reboot();
+  this->firmware_.reset();
+  // Interrupts are not configured after a reset
+  for (auto &pin : this->pins_)
+    pin.second->detach_interrupt();
+  this->hal_.set_boot(from_sleep, cause);
+  this->wakes_.push_back({now_us(), from_sleep, cause, {}});
+  this->firmware_ = this->factory_(*this);
+  App.setup();
+  if (this->hal_.is_asleep())
+    this->wakes_.back().asleep_us = now_us();
+}
+
+void SleepSimulator::run_awake_(uint64_t end_us) {
+  while (now_us() < end_us) {
+    this->fire_events_(now_us());
+    loop_once();
+    if (this->hal_.is_asleep()) {
+      this->wakes_.back().asleep_us = now_us();
+      return;
+    }
+    advance_us(this->loop_us_);
+  }
+}
+
+void SleepSimulator::run_asleep_(uint64_t end_us) {
+  const SleepRecord sleep = this->hal_.get_records().back();
+  optional<uint64_t> timer_at;
+  if (sleep.timer_us.has_value())
+    timer_at = sleep.start_us + static_cast<uint64_t>(std::llround(*sleep.timer_us * this->timer_drift_));
+
+  // Whatever woke the device, the RTC counted the time at the drifted rate
+  auto wake = [this, &sleep](deep_sleep::WakeCause cause) {
+    const double slept_us = static_cast<double>(now_us() - sleep.start_us);
+    adjust_system_time_us(std::llround(slept_us / this->timer_drift_ - slept_us));
+    this->boot_(true, cause);
+  };
+
+  while (true) {
+    // The wakeup pin is level triggered, so a pin that is already active wakes the device at once
+    if (this->wakeup_pin_active_()) {
+      wake(deep_sleep::WAKE_CAUSE_GPIO);
+      return;
+    }
+    uint64_t next_us = end_us;
+    if (timer_at.has_value() && *timer_at < next_us)
+      next_us = *timer_at;
+    if (!this->events_.empty() && this->events_.begin()->first < next_us) {
+      advance_us(std::max(this->events_.begin()->first, now_us()) - now_us());
+      this->fire_events_(now_us());
+      continue;
+    }
+    advance_us(next_us - now_us());
+    if (timer_at.has_value() && next_us == *timer_at)
+      wake(deep_sleep::WAKE_CAUSE_DEFAULT);
+    return;
+  }
+}
+
+void SleepSimulator::fire_events_(uint64_t until_us) {
+  while (!this->events_.empty() && this->events_.begin()->first <= until_us) {
+    auto event = std::move(this->events_.begin()->second);
+    this->events_.erase(this->events_.begin());
+    event();
+  }
+}
+
+bool SleepSimulator::wakeup_pin_active_() const {
+  const SleepRecord &sleep = this->hal_.get_records().back();
+  if (sleep.wakeup_pin < 0)
+    return false;
+  auto it = this->pins_.find(sleep.wakeup_pin);
+  // ext0 compares the physical level
+  return it != this->pins_.end() && it->second->get_level() == sleep.wakeup_level;
+}
+
+}  // namespace testing
+}  // namespace esphome
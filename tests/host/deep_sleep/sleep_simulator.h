@@ -0,0 +1,124 @@
+#pragma once
+
+#include "fake_gpio.h"
+#include "host_testing.h"
+
+#include "esphome/components/deep_sleep/deep_sleep_component.h"
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace esphome {
+namespace testing {
+
+/// One call to HostSleepHal::deep_sleep().
+struct SleepRecord {
+  uint64_t start_us;  ///< Simulated time of the call
+  uint32_t awake_ms;  ///< millis() at the call
+  optional<uint64_t> timer_us;
+  int wakeup_pin;  ///< -1 = none
+  bool wakeup_level;
+};
+
+/// One boot: power on or a wake from deep sleep.
+struct WakeRecord {
+  uint64_t at_us;
+  bool from_sleep;
+  deep_sleep::WakeCause cause;
+  optional<uint64_t> asleep_us;  ///< When this boot went to sleep
+};
+
+/// Records what deep_sleep armed and stops the main loop instead of sleeping. Installs itself as the host sleep HAL
+/// for its lifetime.
+class RecordingSleepHal : public deep_sleep::HostSleepHal {
+ public:
+  RecordingSleepHal() { deep_sleep::global_host_sleep_hal = this; }
+  ~RecordingSleepHal() override { deep_sleep::global_host_sleep_hal = this->previous_; }
+
+  void deep_sleep(const deep_sleep::HostSleepRequest &request) override;
+  bool woke_from_deep_sleep() override { return this->woke_from_deep_sleep_; }
+  deep_sleep::WakeCause get_wake_cause() override { return this->wake_cause_; }
+  /// The simulated system time, or time since reset() while it has not been set, like an unsynchronized RTC.
+  int64_t system_time_us() override {
+    return has_system_time() ? testing::system_time_us() : static_cast<int64_t>(now_us());
+  }
+
+  /// What the next boot reports.
+  void set_boot(bool woke_from_deep_sleep, deep_sleep::WakeCause cause) {
+    this->woke_from_deep_sleep_ = woke_from_deep_sleep;
+    this->wake_cause_ = cause;
+    this->asleep_ = false;
+  }
+
+  bool is_asleep() const { return this->asleep_; }
+  const std::vector<SleepRecord> &get_records() const { return this->records_; }
+
+ protected:
+  deep_sleep::HostSleepHal *previous_{deep_sleep::global_host_sleep_hal};
+  std::vector<SleepRecord> records_;
+  bool asleep_{false};
+  bool woke_from_deep_sleep_{false};
+  deep_sleep::WakeCause wake_cause_{deep_sleep::WAKE_CAUSE_DEFAULT};
+};
+
+/// Whatever one boot of the firmware owns; destroyed when the device sleeps or resets.
+struct Firmware {
+  virtual ~Firmware() = default;
+};
+
+class SleepSimulator;
+using FirmwareFactory = std::function<std::unique_ptr<Firmware>(SleepSimulator &)>;
+
+/// Runs a device through power on, wakes and deep sleeps on the simulated clock. Each boot builds fresh firmware
+/// from the factory, registers it with App and runs the main loop until deep_sleep hands over to the HAL. While
+/// asleep the armed timer (stretched by the slow clock error) and wakeup pin decide when and why the next boot
+/// happens. Pins and the retained RTC state outlive the boots, the firmware does not.
+class SleepSimulator {
+ public:
+  explicit SleepSimulator(FirmwareFactory factory);
+  ~SleepSimulator();
+
+  /// A pin of the board, e.g. for the wakeup pin. Owned by the simulator.
+  FakeGPIOPin *add_pin(uint8_t pin, bool inverted = false);
+  FakeGPIOPin *get_pin(uint8_t pin);
+
+  /// Actual over requested duration of timer sleeps; the system time keeps counting the requested one.
+  void set_timer_drift(double factor) { this->timer_drift_ = factor; }
+  /// Main loop period while awake.
+  void set_loop_interval(uint32_t loop_ms) { this->loop_us_ = loop_ms * 1000ULL; }
+  /// Run `event` at simulated time `at_us`, awake or asleep.
+  void schedule(uint64_t at_us, std::function<void()> &&event);
+
+  /// Power on (if not yet done) and run until simulated time `end_us`.
+  void run_until(uint64_t end_us);
+  void run_for_ms(uint64_t duration_ms) { this->run_until(now_us() + duration_ms * 1000); }
+  /// Cut and restore power: the device boots now, awake or asleep, and the retained state is no longer valid.
+  void power_cycle();
+
+  bool is_asleep() const { return this->hal_.is_asleep(); }
+  Firmware *get_firmware() { return this->firmware_.get(); }
+  RecordingSleepHal &get_hal() { return this->hal_; }
+  const std::vector<WakeRecord> &get_wakes() const { return this->wakes_; }
+
+ protected:
+  void boot_(bool from_sleep, deep_sleep::WakeCause cause);
+  void run_awake_(uint64_t end_us);
+  void run_asleep_(uint64_t end_us);
+  void fire_events_(uint64_t until_us);
+  bool wakeup_pin_active_() const;
+
+  FirmwareFactory factory_;
+  RecordingSleepHal hal_;
+  std::unique_ptr<Firmware> firmware_;
+  std::map<uint8_t, std::unique_ptr<FakeGPIOPin>> pins_;
+  std::multimap<uint64_t, std::function<void()>> events_;
+  std::vector<WakeRecord> wakes_;
+  double timer_drift_{1.0};
+  uint64_t loop_us_{16000};
+  bool powered_{false};
+};
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,105 @@
+#include "sleep_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace esphome {
+namespace testing {
+
+static std::vector<std::string> split(const std::string &line) {
+  std::vector<std::string> fields;
+  std::stringstream stream(line);
+  std::string field;
+  while (std::getline(stream, field, ','))
+    fields.push_back(field);
+  return fields;
+}
+
+static bool parse_double(const std::string &text, double *value) {
+  char *end = nullptr;
+  *value = std::strtod(text.c_str(), &end);
+  return end != text.c_str() && *end == '\0' && std::isfinite(*value);
+}
+
+bool SleepTrace::load(const std::string &path, std::string *error) {
+  std::ifstream file(path);
+  if (!file) {
+    *error = "cannot open " + path;
+    return false;
+  }
+  this->values.clear();
+  this->presses.clear();
+  this->holds.clear();
+  std::string line;
+  for (int number = 1; std::getline(file, line); number++) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty() || line[0] == '#')
+      continue;
+    const auto fields = split(line);
+    double t_s = 0;
+    double number_value = 0;
+    bool ok = fields.size() >= 3 && parse_double(fields[0], &t_s) && t_s >= 0;
+    if (ok && fields[1] == "value" && fields.size() == 3 && parse_double(fields[2], &number_value)) {
+      this->values.push_back({t_s, static_cast<float>(number_value)});
+    } else if (ok && fields[1] == "press" && fields.size() == 3 && parse_double(fields[2], &number_value) &&
+               number_value > 0) {
+      this->presses.push_back({t_s, number_value});
+    } else if (ok && fields[1] == "hold" && fields.size() == 4 && !fields[2].empty() &&
+               parse_double(fields[3], &number_value) && number_value > 0) {
+      this->holds.push_back({t_s, fields[2], number_value});
+    } else {
+      *error = path + ":" + std::to_string(number) + ": cannot parse '" + line + "'";
+      return false;
+    }
+  }
+  auto by_time = [](const auto &a, const auto &b) { return a.t_s < b.t_s; };
+  std::stable_sort(this->values.begin(), this->values.end(), by_time);
+  std::stable_sort(this->presses.begin(), this->presses.end(), by_time);
+  std::stable_sort(this->holds.begin(), this->holds.end(), by_time);
+  return true;
+}
+
+SleepTrace SleepTrace::synthetic(uint32_t days) {
+  SleepTrace trace;
+  for (uint32_t day = 0; day < days; day++) {
+    const double base = day * 86400.0;
+    // Night at outdoor level, a steep rise when people arrive, airing at lunch, slow decay in the evening
+    trace.values.push_back({base, 440.0f});
+    trace.values.push_back({base + 7.5 * 3600, 450.0f});
+    trace.values.push_back({base + 9 * 3600, 1150.0f});
+    trace.values.push_back({base + 12 * 3600, 1250.0f});
+    trace.values.push_back({base + 12.25 * 3600, 620.0f});
+    trace.values.push_back({base + 13.5 * 3600, 980.0f});
+    trace.values.push_back({base + 17.5 * 3600, 1100.0f});
+    trace.values.push_back({base + 23 * 3600, 480.0f});
+
+    trace.presses.push_back({base + 7.25 * 3600, 90.0});  // held while reading the display
+    trace.presses.push_back({base + 19 * 3600 + 17, 0.4});
+
+    trace.holds.push_back({base + 3 * 3600, "ota", 45.0});
+    if (day == 1)
+      trace.holds.push_back({base + 14 * 3600, "stuck", 2 * 3600.0});  // never let go while the window lasts
+  }
+  return trace;
+}
+
+float SleepTrace::value_at(double t_s) const {
+  if (this->values.empty())
+    return NAN;
+  auto next = std::upper_bound(this->values.begin(), this->values.end(), t_s,
+                               [](double t, const Value &value) { return t < value.t_s; });
+  if (next == this->values.begin())
+    return next->value;
+  auto prev = next - 1;
+  if (next == this->values.end() || next->t_s == prev->t_s)
+    return prev->value;
+  const double fraction = (t_s - prev->t_s) / (next->t_s - prev->t_s);
+  return static_cast<float>(prev->value + fraction * (next->value - prev->value));
+}
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace testing {
+
+/// What happens around a sleeping device over a simulated run, in seconds since the run started (midnight UTC,
+/// 2026-01-01):
+///
+///   # comment
+///   <t_s>,value,<value>           sensor reading from t on, interpolated linearly to the next one
+///   <t_s>,press,<duration_s>      wakeup button held down for the duration
+///   <t_s>,hold,<name>,<duration_s>  something holds a sleep inhibitor while the device is awake in the window
+struct SleepTrace {
+  struct Value {
+    double t_s;
+    float value;
+  };
+  struct Press {
+    double t_s;
+    double duration_s;
+  };
+  struct Hold {
+    double t_s;
+    std::string name;
+    double duration_s;
+  };
+
+  /// Parses the file; false with `error` set on the first bad line.
+  bool load(const std::string &path, std::string *error);
+  /// Office CO2 with a morning button press and the occasional OTA on each day, and one stuck holder on day 2.
+  static SleepTrace synthetic(uint32_t days);
+
+  float value_at(double t_s) const;
+
+  std::vector<Value> values;
+  std::vector<Press> presses;
+  std::vector<Hold> holds;
+};
+
+/// Epoch of simulated time 0.
+static const int64_t SLEEP_TRACE_EPOCH = 1767225600;  // 2026-01-01 00:00:00 UTC
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,189 @@
+// Drives MTP40FComponent::setup()/update()/loop() through the simulated UART under a set of line faults and reports
+// how long each call held the main loop (wall clock), how long polls took (simulated), timeouts and the poll
+// success rate. Exits non-zero if a call blocked the loop or a clean line lost polls.
+//
+//   mtp40f_bench [--minutes N] [--interval MS] [--seed N]
+
+#include "mtp40f_harness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::testing;
+
+namespace {
+
+struct Scenario {
+  const char *name;
+  MTP40FFaults faults;
+};
+
+MTP40FFaults faults(uint32_t latency_ms, uint32_t jitter_ms = 0) {
+  MTP40FFaults f;
+  f.latency_ms = latency_ms;
+  f.jitter_ms = jitter_ms;
+  return f;
+}
+
+std::vector<Scenario> scenarios() {
+  std::vector<Scenario> list;
+  list.push_back({"clean", faults(30)});
+  list.push_back({"slow", faults(300, 400)});
+  list.push_back({"late", faults(600, 800)});  // part of the replies arrive after the timeout
+  list.push_back({"drops 5%", faults(30)});
+  list.back().faults.drop_rate = 0.05f;
+  list.push_back({"corrupt 5%", faults(30)});
+  list.back().faults.corrupt_rate = 0.05f;
+  list.push_back({"noise 20%", faults(30)});
+  list.back().faults.noise_rate = 0.2f;
+  list.push_back({"byte drops 1%", faults(30)});
+  list.back().faults.byte_drop_rate = 0.01f;
+  list.push_back({"silent", faults(30)});
+  list.back().faults.silent = true;
+  return list;
+}
+
+class Samples {
+ public:
+  void add(double value) { this->values_.push_back(value); }
+  size_t size() const { return this->values_.size(); }
+  // Nearest rank
+  double percentile(double p) {
+    if (this->values_.empty())
+      return NAN;
+    std::sort(this->values_.begin(), this->values_.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * this->values_.size()));
+    return this->values_[std::min(std::max<size_t>(rank, 1), this->values_.size()) - 1];
+  }
+  double max() { return this->percentile(100.0); }
+
+ protected:
+  std::vector<double> values_;
+};
+
+// Runs right before the MTP40F in the main loop and notes whether it has anything to do, so idle passes (which
+// return at once) do not flatten the loop percentiles
+class BusyProbe : public Component {
+ public:
+  explicit BusyProbe(mtp40f::MTP40FComponent *component) : component_(component) {}
+  void loop() override { this->busy = this->component_->is_busy(); }
+  float get_setup_priority() const override { return setup_priority::DATA; }
+  bool busy{false};
+
+ protected:
+  mtp40f::MTP40FComponent *component_;
+};
+
+struct Result {
+  std::string name;
+  uint32_t polls;
+  uint32_t ok;
+  uint32_t timeouts;
+  uint32_t crc_errors;
+  Samples rtt_ms;
+  Samples loop_us;
+  Samples update_us;
+  uint64_t blocked_us;
+};
+
+Result run(const Scenario &scenario, uint64_t minutes, uint32_t interval_ms, uint32_t seed) {
+  MTP40FHarness h(seed);
+  h.uart.faults() = scenario.faults;
+  // Slow drift around 600 ppm with a one hour period
+  h.uart.set_ppm_source([](uint64_t now_us) {
+    return static_cast<uint32_t>(600.0 + 200.0 * std::sin(now_us / 3.6e9 * 2.0 * M_PI));
+  });
+  h.component.set_update_interval(interval_ms);
+
+  Result result{};
+  result.name = scenario.name;
+  uint64_t request_us = 0;
+  h.uart.set_on_request([&request_us](uint8_t opcode) {
+    if (opcode == mtp40f::MTP40FGetGasConcentration::OPCODE)
+      request_us = now_us();
+  });
+  h.co2.add_on_state_callback([&result, &request_us](float) { result.rtt_ms.add((now_us() - request_us) / 1000.0); });
+
+  BusyProbe probe(&h.component);
+  App.register_component(&probe);
+  set_call_observer([&](const CallTiming &call) {
+    if (call.component != &h.component)
+      return;
+    result.blocked_us += call.blocked_us;
+    if (!call.is_loop) {
+      result.update_us.add(call.wall_ns / 1000.0);
+    } else if (probe.busy) {
+      result.loop_us.add(call.wall_ns / 1000.0);
+    }
+  });
+  h.start();
+  h.run_ms(minutes * 60 * 1000);
+  set_call_observer(nullptr);
+
+  result.polls = h.uart.get_request_count(mtp40f::MTP40FGetGasConcentration::OPCODE);
+  result.ok = h.published.size();
+  result.timeouts = h.component.get_metrics().total_timeouts();
+  result.crc_errors = h.component.get_metrics().total_crc_errors();
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  uint64_t minutes = 60;
+  uint32_t interval_ms = 5000;
+  uint32_t seed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "--minutes") == 0) {
+      minutes = std::strtoull(argv[i + 1], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--interval") == 0) {
+      interval_ms = std::strtoul(argv[i + 1], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--seed") == 0) {
+      seed = std::strtoul(argv[i + 1], nullptr, 10);
+    } else {
+      std::fprintf(stderr, "usage: %s [--minutes N] [--interval MS] [--seed N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::printf("MTP40F host benchmark: %llu simulated minutes per scenario, update interval %u ms, seed %u\n",
+              static_cast<unsigned long long>(minutes), interval_ms, seed);
+  std::printf("loop() counts only passes with a request in flight or queued; wall clock times of this host\n\n");
+  std::printf("%-14s %6s %6s %7s %5s %5s | %-24s | %-20s | %-20s\n", "scenario", "polls", "ok", "success", "tmo",
+              "crc", "poll rtt ms p50/p99/max", "loop us p50/p99/max", "update us p50/p99/max");
+
+  int failures = 0;
+  for (const auto &scenario : scenarios()) {
+    Result r = run(scenario, minutes, interval_ms, seed);
+    const double success = r.polls == 0 ? 0.0 : 100.0 * r.ok / r.polls;
+    std::printf("%-14s %6u %6u %6.1f%% %5u %5u | %6.0f %6.0f %8.0f  | %5.1f %6.1f %6.1f | %5.1f %6.1f %6.1f\n",
+                r.name.c_str(), r.polls, r.ok, success, r.timeouts, r.crc_errors, r.rtt_ms.percentile(50),
+                r.rtt_ms.percentile(99), r.rtt_ms.max(), r.loop_us.percentile(50), r.loop_us.percentile(99),
+                r.loop_us.max(), r.update_us.percentile(50), r.update_us.percentile(99), r.update_us.max());
+
+    if (r.blocked_us != 0) {
+      std::printf("  FAIL: blocked the loop for %llu us of simulated time\n",
+                  static_cast<unsigned long long>(r.blocked_us));
+      failures++;
+    }
+    if (r.rtt_ms.size() != 0 && r.rtt_ms.max() > mtp40f::MTP40F_RESPONSE_TIMEOUT_MS + 16) {
+      std::printf("  FAIL: a poll completed after the response timeout\n");
+      failures++;
+    }
+    if (std::strcmp(r.name.c_str(), "clean") == 0 && (r.polls == 0 || r.ok != r.polls || r.timeouts != 0)) {
+      std::printf("  FAIL: lost polls on a clean line\n");
+      failures++;
+    }
+    if (std::strcmp(r.name.c_str(), "silent") == 0 && r.ok != 0) {
+      std::printf("  FAIL: readings from a silent sensor\n");
+      failures++;
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "mtp40f_simulator.h"
+#include "host_testing.h"
+
+#include "esphome/components/mtp40f/mtp40f.h"
+#include "esphome/core/application.h"
+
+#include <vector>
+
+namespace esphome {
+namespace testing {
+
+// One MTP40F on a simulated UART, wired up the way the generated code does it. The sensor is ready straight away
+// (no warm-up) and polls every 5 s unless the test changes that before start().
+struct MTP40FHarness {
+  explicit MTP40FHarness(uint32_t seed = 1) : uart(seed) {
+    reset();
+    this->component.set_uart_parent(&this->uart);
+    this->component.set_co2_sensor(&this->co2);
+    this->component.set_update_interval(5000);
+    this->component.set_warmup_seconds(0);
+    this->co2.set_name("CO2");
+    this->co2.add_on_state_callback([this](float state) { this->published.push_back(state); });
+  }
+
+  void start() {
+    App.register_component(&this->component);
+    App.register_sensor(&this->co2);
+    App.setup();
+  }
+
+  // Run the main loop with ESPHome's default 16 ms loop interval
+  void run_ms(uint64_t duration_ms, uint32_t step_ms = 16) { run_for(duration_ms, step_ms); }
+
+  MTP40FSimulator uart;
+  mtp40f::MTP40FComponent component;
+  sensor::Sensor co2;
+  std::vector<float> published;
+};
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,207 @@
+#include "mtp40f_simulator.h"
+#include "host_testing.h"
+
+#include "esphome/components/mtp40f/mtp40f_protocol.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace testing {
+
+using mtp40f::MTP40F_FRAME_HEADER;
+using mtp40f::MTP40F_FRAME_HEADER_LENGTH;
+using mtp40f::MTP40F_FRAME_OVERHEAD;
+
+void MTP40FSimulator::write_array(const uint8_t *data, size_t len) {
+  if (!this->powered_())
+    return;
+  this->request_.insert(this->request_.end(), data, data + len);
+  this->parse_requests_();
+}
+
+bool MTP40FSimulator::peek_byte(uint8_t *data) {
+  if (this->ready_count_() == 0)
+    return false;
+  *data = this->line_.front().value;
+  return true;
+}
+
+bool MTP40FSimulator::read_array(uint8_t *data, size_t len) {
+  if (this->ready_count_() < len)
+    return false;
+  for (size_t i = 0; i < len; i++) {
+    data[i] = this->line_.front().value;
+    this->line_.pop_front();
+  }
+  return true;
+}
+
+int MTP40FSimulator::available() { return static_cast<int>(this->ready_count_()); }
+
+void MTP40FSimulator::inject(const std::vector<uint8_t> &bytes) { this->send_(bytes, now_us()); }
+
+bool MTP40FSimulator::powered_() {
+  const bool powered = this->power_pin_ == nullptr || this->power_pin_->get_level();
+  if (powered != this->was_powered_) {
+    this->was_powered_ = powered;
+    // Whatever was in flight is lost, and the sensor comes back with its defaults
+    this->line_.clear();
+    this->request_.clear();
+    this->air_pressure_reference_ = 1013;
+    this->self_calibration_ = true;
+    if (powered) {
+      this->power_on_us_ = now_us();
+      this->power_ons_++;
+    }
+  }
+  return powered;
+}
+
+// Frames are taken off the front as they complete; bytes that cannot start a valid frame are skipped one by one
+void MTP40FSimulator::parse_requests_() {
+  while (this->request_.size() >= MTP40F_FRAME_HEADER_LENGTH) {
+    if (!std::equal(std::begin(MTP40F_FRAME_HEADER), std::end(MTP40F_FRAME_HEADER), this->request_.begin())) {
+      this->request_.erase(this->request_.begin());
+      this->bad_requests_++;
+      continue;
+    }
+    const size_t payload_length = (this->request_[5] << 8) | this->request_[6];
+    const size_t frame_length = MTP40F_FRAME_OVERHEAD + payload_length;
+    if (payload_length > mtp40f::MTP40F_MAX_PAYLOAD_LENGTH) {
+      this->request_.erase(this->request_.begin());
+      this->bad_requests_++;
+      continue;
+    }
+    if (this->request_.size() < frame_length)
+      return;
+    const uint16_t sum = mtp40f::mtp40f_sum(this->request_.data(), frame_length - 2);
+    if (this->request_[frame_length - 2] != (sum >> 8) || this->request_[frame_length - 1] != (sum & 0xFF)) {
+      this->request_.erase(this->request_.begin());
+      this->bad_requests_++;
+      continue;
+    }
+    const uint8_t opcode = this->request_[4];
+    std::vector<uint8_t> payload(this->request_.begin() + MTP40F_FRAME_HEADER_LENGTH,
+                                 this->request_.begin() + MTP40F_FRAME_HEADER_LENGTH + payload_length);
+    this->request_.erase(this->request_.begin(), this->request_.begin() + frame_length);
+    // The write returns at once; the sensor only has the whole request after it was clocked out
+    this->request_end_us_ = now_us() + frame_length * BYTE_TIME_US;
+    this->requests_[opcode & 7]++;
+    if (this->on_request_)
+      this->on_request_(opcode);
+    this->handle_request_(opcode, payload);
+  }
+}
+
+void MTP40FSimulator::handle_request_(uint8_t opcode, const std::vector<uint8_t> &payload) {
+  switch (opcode) {
+    case 0x01:  // set air pressure reference, no reply
+      if (payload.size() == 2)
+        this->air_pressure_reference_ = (payload[0] << 8) | payload[1];
+      break;
+    case 0x02:
+      this->reply_(opcode, {static_cast<uint8_t>(this->air_pressure_reference_ >> 8),
+                            static_cast<uint8_t>(this->air_pressure_reference_ & 0xFF)});
+      break;
+    case 0x03: {
+      const uint32_t ppm = this->ppm_source_(now_us());
+      const bool warming = now_us() - this->power_on_us_ < this->warmup_ms_ * 1000ULL;
+      this->reply_(opcode, {static_cast<uint8_t>(ppm >> 24), static_cast<uint8_t>(ppm >> 16),
+                            static_cast<uint8_t>(ppm >> 8), static_cast<uint8_t>(ppm & 0xFF),
+                            warming ? static_cast<uint8_t>(0x01) : this->status_});
+      break;
+    }
+    case 0x04:
+      if (payload.size() == 4)
+        this->calibrated_ppm_ = payload[0] << 24 | payload[1] << 16 | payload[2] << 8 | payload[3];
+      this->reply_(opcode, {0x00});
+      break;
+    case 0x06:
+      if (payload.size() == 1)
+        this->self_calibration_ = payload[0] == 0x00;
+      this->reply_(opcode, {});
+      break;
+    case 0x07:
+      this->reply_(opcode, {static_cast<uint8_t>(this->self_calibration_ ? 0x01 : 0x00)});
+      break;
+    default:
+      this->bad_requests_++;
+      break;
+  }
+}
+
+void MTP40FSimulator::reply_(uint8_t opcode, const std::vector<uint8_t> &payload) {
+  if (this->faults_.silent || this->chance_(this->faults_.drop_rate))
+    return;
+
+  std::vector<uint8_t> frame(std::begin(MTP40F_FRAME_HEADER), std::end(MTP40F_FRAME_HEADER));
+  frame.push_back(0x00);
+  frame.push_back(opcode);
+  frame.push_back(static_cast<uint8_t>(payload.size() >> 8));
+  frame.push_back(static_cast<uint8_t>(payload.size() & 0xFF));
+  frame.insert(frame.end(), payload.begin(), payload.end());
+  const uint16_t sum = mtp40f::mtp40f_sum(frame.data(), frame.size());
+  frame.push_back(static_cast<uint8_t>(sum >> 8));
+  frame.push_back(static_cast<uint8_t>(sum & 0xFF));
+
+  if (this->chance_(this->faults_.corrupt_rate)) {
+    std::uniform_int_distribution<size_t> position(0, frame.size() - 1);
+    std::uniform_int_distribution<int> bit(0, 7);
+    frame[position(this->rng_)] ^= 1 << bit(this->rng_);
+  }
+  if (this->chance_(this->faults_.noise_rate)) {
+    std::uniform_int_distribution<int> count(1, 4);
+    std::uniform_int_distribution<int> value(0, 255);
+    std::vector<uint8_t> noise(count(this->rng_));
+    for (auto &byte : noise)
+      byte = value(this->rng_);
+    frame.insert(frame.begin(), noise.begin(), noise.end());
+  }
+  if (this->faults_.byte_drop_rate > 0.0f) {
+    frame.erase(std::remove_if(frame.begin(), frame.end(),
+                               [this](uint8_t) { return this->chance_(this->faults_.byte_drop_rate); }),
+                frame.end());
+  }
+
+  uint64_t start_us = this->request_end_us_ + this->faults_.latency_ms * 1000ULL;
+  if (this->faults_.jitter_ms != 0) {
+    std::uniform_int_distribution<uint32_t> jitter(0, this->faults_.jitter_ms * 1000);
+    start_us += jitter(this->rng_);
+  }
+  this->replies_++;
+  this->send_(frame, start_us);
+}
+
+// Bytes leave one byte time apart and never overtake the ones already on the line
+void MTP40FSimulator::send_(const std::vector<uint8_t> &bytes, uint64_t start_us) {
+  uint64_t ready_us = start_us;
+  if (!this->line_.empty())
+    ready_us = std::max(ready_us, this->line_.back().ready_us + BYTE_TIME_US);
+  for (uint8_t byte : bytes) {
+    this->line_.push_back({ready_us, byte});
+    ready_us += BYTE_TIME_US;
+  }
+}
+
+size_t MTP40FSimulator::ready_count_() {
+  if (!this->powered_())
+    return 0;
+  const uint64_t now = now_us();
+  size_t count = 0;
+  for (const auto &byte : this->line_) {
+    if (byte.ready_us > now)
+      break;
+    count++;
+  }
+  return count;
+}
+
+bool MTP40FSimulator::chance_(float rate) {
+  if (rate <= 0.0f)
+    return false;
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  return uniform(this->rng_) < rate;
+}
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "esphome/components/uart/uart.h"
+#include "fake_gpio.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace esphome {
+namespace testing {
+
+// Line faults, drawn per reply (or per byte) from a seeded generator so every run is reproducible.
+struct MTP40FFaults {
+  uint32_t latency_ms{30};   // from the end of the request to the first reply byte
+  uint32_t jitter_ms{0};     // uniformly added to the latency
+  float drop_rate{0.0f};     // whole reply lost
+  float corrupt_rate{0.0f};  // one bit of the reply flipped
+  float noise_rate{0.0f};    // 1-4 garbage bytes sent before the reply
+  float byte_drop_rate{0.0f};
+  bool silent{false};        // answers nothing, like a disconnected sensor
+};
+
+// The sensor end of the UART: parses request frames and answers them like an MTP40F at 9600 baud. Reply bytes
+// become readable one byte time apart, so the component sees partial frames exactly as on the wire.
+class MTP40FSimulator : public uart::UARTComponent {
+ public:
+  static constexpr uint32_t BYTE_TIME_US = 1042;  // 10 bits at 9600 baud
+
+  explicit MTP40FSimulator(uint32_t seed = 1) : rng_(seed) {}
+
+  void write_array(const uint8_t *data, size_t len) override;
+  bool peek_byte(uint8_t *data) override;
+  bool read_array(uint8_t *data, size_t len) override;
+  int available() override;
+  void flush() override {}
+
+  MTP40FFaults &faults() { return this->faults_; }
+  void set_ppm(uint32_t ppm) {
+    this->ppm_source_ = [ppm](uint64_t) { return ppm; };
+  }
+  // CO2 as a function of the simulated time
+  void set_ppm_source(std::function<uint32_t(uint64_t now_us)> &&source) { this->ppm_source_ = std::move(source); }
+  // Status byte of CO2 replies; 0 = valid
+  void set_status(uint8_t status) { this->status_ = status; }
+  // Answer CO2 requests with status 0x01 for this long after power on
+  void set_warmup_ms(uint32_t warmup_ms) { this->warmup_ms_ = warmup_ms; }
+  // The sensor is off (silent, settings lost) while this pin is low. Assumed high before the first check
+  void set_power_pin(FakeGPIOPin *pin) { this->power_pin_ = pin; }
+  // Put raw bytes on the line right now
+  void inject(const std::vector<uint8_t> &bytes);
+
+  // Called for every valid request with its opcode, when the last byte arrives
+  void set_on_request(std::function<void(uint8_t opcode)> &&callback) { this->on_request_ = std::move(callback); }
+  uint32_t get_request_count(uint8_t opcode) const { return this->requests_[opcode & 7]; }
+  uint32_t get_bad_request_count() const { return this->bad_requests_; }
+  uint32_t get_reply_count() const { return this->replies_; }
+  uint16_t get_air_pressure_reference() const { return this->air_pressure_reference_; }
+  bool get_self_calibration() const { return this->self_calibration_; }
+  uint32_t get_calibrated_ppm() const { return this->calibrated_ppm_; }
+  // Times the power pin went from low to high
+  uint32_t get_power_on_count() const { return this->power_ons_; }
+
+ protected:
+  struct LineByte {
+    uint64_t ready_us;
+    uint8_t value;
+  };
+
+  bool powered_();
+  void parse_requests_();
+  void handle_request_(uint8_t opcode, const std::vector<uint8_t> &payload);
+  void reply_(uint8_t opcode, const std::vector<uint8_t> &payload);
+  void send_(const std::vector<uint8_t> &bytes, uint64_t start_us);
+  size_t ready_count_();
+  bool chance_(float rate);
+
+  MTP40FFaults faults_;
+  std::mt19937 rng_;
+  std::function<uint32_t(uint64_t)> ppm_source_{[](uint64_t) { return 420u; }};
+  std::function<void(uint8_t)> on_request_;
+  FakeGPIOPin *power_pin_{nullptr};
+  bool was_powered_{true};
+  uint64_t power_on_us_{0};
+  uint32_t warmup_ms_{0};
+  uint8_t status_{0x00};
+
+  std::vector<uint8_t> request_;
+  uint64_t request_end_us_{0};
+  std::deque<LineByte> line_;
+
+  uint16_t air_pressure_reference_{1013};
+  bool self_calibration_{true};
+  uint32_t calibrated_ppm_{0};
+  uint32_t requests_[8]{};
+  uint32_t bad_requests_{0};
+  uint32_t replies_{0};
+  uint32_t power_ons_{0};
+};
+
+}  // namespace testing
+}  // namespace esphome
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "esphome/core/gpio.h"
+
+namespace esphome {
+namespace testing {
+
+// A pin whose physical level the test drives. Attached interrupts fire synchronously on matching edges.
+class FakeGPIOPin : public InternalGPIOPin {
+ public:
+  explicit FakeGPIOPin(uint8_t pin, bool inverted = false) : pin_(pin), inverted_(inverted) {}
+
+  void setup() override { this->setup_count_++; }
+  void pin_mode(gpio::Flags flags) override { this->flags_ = flags; }
+  bool digital_read() override { return this->level_ != this->inverted_; }
+  void digital_write(bool value) override {
+    this->level_ = value != this->inverted_;
+    this->write_count_++;
+  }
+  std::string dump_summary() const override { return "GPIO" + std::to_string(this->pin_); }
+  void detach_interrupt() const override { this->isr_ = nullptr; }
+  uint8_t get_pin() const override { return this->pin_; }
+  bool is_inverted() const override { return this->inverted_; }
+
+  /// Drive the physical level from outside, e.g. a button.
+  void set_level(bool level) {
+    if (level == this->level_)
+      return;
+    this->level_ = level;
+    bool fire = this->isr_type_ == gpio::INTERRUPT_ANY_EDGE ||
+                (this->isr_type_ == gpio::INTERRUPT_RISING_EDGE && level) ||
+                (this->isr_type_ == gpio::INTERRUPT_FALLING_EDGE && !level);
+    if (this->isr_ != nullptr && fire)
+      this->isr_(this->isr_arg_);
+  }
+  bool get_level() const { return this->level_; }
+  bool has_interrupt() const { return this->isr_ != nullptr; }
+  uint32_t get_write_count() const { return this->write_count_; }
+  uint32_t get_setup_count() const { return this->setup_count_; }
+
+ protected:
+  void attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const override {
+    this->isr_ = func;
+    this->isr_arg_ = arg;
+    this->isr_type_ = type;
+  }
+
+  uint8_t pin_;
+  bool inverted_;
+  bool level_{false};
+  gpio::Flags flags_{gpio::FLAG_NONE};
+  uint32_t write_count_{0};
+  uint32_t setup_count_{0};
+  mutable void (*isr_)(void *){nullptr};
+  mutable void *isr_arg_{nullptr};
+  mutable gpio::InterruptType isr_type_{gpio::INTERRUPT_ANY_EDGE};
+};
+
+}  // namespace testing
+}  // namespace esphome
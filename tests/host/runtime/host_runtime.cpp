@@ -0,0 +1,395 @@
+#include "host_testing.h"
+
+#include "esphome/core/application.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "esphome/core/scheduler.h"
+#include "esphome/core/time.h"
+#ifdef USE_TIME
+#include "esphome/components/time/real_time_clock.h"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace esphome {
+
+namespace setup_priority {
+
+const float BUS = 1000.0f;
+const float IO = 900.0f;
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float PROCESSOR = 400.0f;
+const float WIFI = 250.0f;
+const float AFTER_WIFI = 200.0f;
+const float AFTER_CONNECTION = 100.0f;
+const float LATE = -100.0f;
+
+}  // namespace setup_priority
+
+Application App;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+static ESPPreferences host_preferences;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+ESPPreferences *global_preferences = &host_preferences;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+namespace testing {
+
+struct RuntimeState {
+  uint64_t now_us{0};
+  uint64_t boot_us{0};
+  uint64_t blocked_us{0};
+  bool has_system_time{false};
+  int64_t system_time_offset_us{0};  // system time = now_us + offset
+  bool halted{false};
+  std::function<void(const CallTiming &)> observer;
+  std::vector<LogLine> log_lines;
+  int print_level{-1};
+};
+
+static RuntimeState state;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+static int print_level() {
+  if (state.print_level < 0) {
+    const char *env = std::getenv("ESPHOME_HOST_LOG_LEVEL");
+    state.print_level = env != nullptr ? std::atoi(env) : ESPHOME_LOG_LEVEL_ERROR;
+  }
+  return state.print_level;
+}
+
+void reset() {
+  state.now_us = 0;
+  state.blocked_us = 0;
+  state.has_system_time = false;
+  state.system_time_offset_us = 0;
+  state.log_lines.clear();
+  state.observer = nullptr;
+  host_preferences.reset();
+  reboot();
+}
+
+void reboot() {
+  state.boot_us = state.now_us;
+  state.halted = false;
+  App = Application();
+}
+
+uint64_t now_us() { return state.now_us; }
+void advance_us(uint64_t us) { state.now_us += us; }
+uint64_t blocked_us() { return state.blocked_us; }
+
+void set_system_time(int64_t epoch_us) {
+  state.has_system_time = true;
+  state.system_time_offset_us = epoch_us - static_cast<int64_t>(state.now_us);
+}
+bool has_system_time() { return state.has_system_time; }
+int64_t system_time_us() {
+  return state.has_system_time ? static_cast<int64_t>(state.now_us) + state.system_time_offset_us : 0;
+}
+void adjust_system_time_us(int64_t delta_us) { state.system_time_offset_us += delta_us; }
+
+bool loop_once() {
+  if (!state.halted)
+    App.loop();
+  return !state.halted;
+}
+
+void run_for(uint64_t duration_ms, uint32_t step_ms) {
+  const uint64_t end_us = state.now_us + duration_ms * 1000;
+  while (!state.halted && state.now_us < end_us) {
+    App.loop();
+    advance_us(static_cast<uint64_t>(step_ms) * 1000);
+  }
+}
+
+void halt() { state.halted = true; }
+bool is_halted() { return state.halted; }
+
+void set_call_observer(std::function<void(const CallTiming &)> &&observer) { state.observer = std::move(observer); }
+
+// Times one call from the main loop into `component`
+template<typename F> static void timed_call(Component *component, bool is_loop, F &&f) {
+  if (!state.observer) {
+    f();
+    return;
+  }
+  const uint64_t blocked_before = state.blocked_us;
+  const auto start = std::chrono::steady_clock::now();
+  f();
+  const auto wall = std::chrono::steady_clock::now() - start;
+  state.observer({component, is_loop, static_cast<uint64_t>(std::chrono::nanoseconds(wall).count()),
+                  state.blocked_us - blocked_before});
+}
+
+void set_print_level(int level) { state.print_level = level; }
+const std::vector<LogLine> &log_lines() { return state.log_lines; }
+
+size_t count_log_lines(int level, const std::string &substring) {
+  return std::count_if(state.log_lines.begin(), state.log_lines.end(), [&](const LogLine &line) {
+    return line.level == level && line.message.find(substring) != std::string::npos;
+  });
+}
+
+}  // namespace testing
+
+// hal.h
+
+uint32_t millis() { return static_cast<uint32_t>((testing::state.now_us - testing::state.boot_us) / 1000); }
+uint32_t micros() { return static_cast<uint32_t>(testing::state.now_us - testing::state.boot_us); }
+void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+void delayMicroseconds(uint32_t us) {
+  testing::state.now_us += us;
+  testing::state.blocked_us += us;
+}
+void yield() {}
+void arch_restart() {
+  std::fprintf(stderr, "arch_restart() called in the host harness\n");
+  std::abort();
+}
+void arch_feed_wdt() {}
+
+// log.h
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {  // NOLINT
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  std::vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  testing::state.log_lines.push_back({level, tag, buffer});
+  if (level <= testing::print_level()) {
+    static const char *const LETTERS = "NEWICDVV";
+    std::fprintf(stderr, "[%10.3f][%c][%s:%d]: %s\n", millis() / 1000.0, LETTERS[level & 7], tag, line, buffer);
+  }
+}
+
+// helpers.h
+
+uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc, uint16_t reverse_poly, bool refin, bool refout) {
+  if (refin)
+    crc ^= 0xffff;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      if (crc & 0x0001) {
+        crc = (crc >> 1) ^ reverse_poly;
+      } else {
+        crc >>= 1;
+      }
+    }
+  }
+  return refout ? (crc ^ 0xffff) : crc;
+}
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+std::string format_hex_pretty(const uint8_t *data, size_t length, char separator, bool show_length) {
+  if (data == nullptr || length == 0)
+    return "";
+  std::string out;
+  char byte[3];
+  for (size_t i = 0; i < length; i++) {
+    if (i != 0 && separator != 0)
+      out += separator;
+    std::snprintf(byte, sizeof(byte), "%02X", data[i]);
+    out += byte;
+  }
+  if (show_length && length > 4)
+    out += " (" + std::to_string(length) + ")";
+  return out;
+}
+
+// time.h
+
+ESPTime ESPTime::from_epoch_utc(time_t epoch) {
+  struct tm c_tm {};
+  gmtime_r(&epoch, &c_tm);
+  ESPTime res{};
+  res.second = c_tm.tm_sec;
+  res.minute = c_tm.tm_min;
+  res.hour = c_tm.tm_hour;
+  res.day_of_week = c_tm.tm_wday + 1;
+  res.day_of_month = c_tm.tm_mday;
+  res.day_of_year = c_tm.tm_yday + 1;
+  res.month = c_tm.tm_mon + 1;
+  res.year = c_tm.tm_year + 1900;
+  res.is_dst = false;
+  res.timestamp = epoch;
+  return res;
+}
+
+#ifdef USE_TIME
+namespace time {
+
+time_t RealTimeClock::timestamp_now() {
+  return testing::has_system_time() ? static_cast<time_t>(testing::system_time_us() / 1000000) : 0;
+}
+
+void RealTimeClock::synchronize_epoch_(uint32_t epoch) {
+  testing::set_system_time(static_cast<int64_t>(epoch) * 1000000);
+  for (auto &callback : this->time_sync_callbacks_)
+    callback();
+}
+
+}  // namespace time
+#endif
+
+// component.h
+
+void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+  App.scheduler.set_interval(this, name, interval, std::move(f));
+}
+void Component::set_interval(uint32_t interval, std::function<void()> &&f) {
+  App.scheduler.set_interval(this, "", interval, std::move(f));
+}
+bool Component::cancel_interval(const std::string &name) { return App.scheduler.cancel_interval(this, name); }
+void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+  App.scheduler.set_timeout(this, name, timeout, std::move(f));
+}
+void Component::set_timeout(uint32_t timeout, std::function<void()> &&f) {
+  App.scheduler.set_timeout(this, "", timeout, std::move(f));
+}
+bool Component::cancel_timeout(const std::string &name) { return App.scheduler.cancel_timeout(this, name); }
+
+void PollingComponent::call_setup() {
+  // Like the real one: start the poller first so setup() may stop it
+  this->start_poller();
+  this->setup();
+}
+void PollingComponent::start_poller() {
+  this->set_interval("update", this->get_update_interval(), [this]() { this->update(); });
+}
+void PollingComponent::stop_poller() { this->cancel_interval("update"); }
+
+// scheduler.h
+
+void Scheduler::set_timeout(Component *component, const std::string &name, uint32_t timeout,
+                            std::function<void()> &&func) {
+  this->set_item_(component, name, !name.empty(), false, timeout, std::move(func));
+}
+bool Scheduler::cancel_timeout(Component *component, const std::string &name) {
+  return this->cancel_item_(component, name, false);
+}
+void Scheduler::set_interval(Component *component, const std::string &name, uint32_t interval,
+                             std::function<void()> &&func) {
+  this->set_item_(component, name, !name.empty(), true, interval, std::move(func));
+}
+bool Scheduler::cancel_interval(Component *component, const std::string &name) {
+  return this->cancel_item_(component, name, true);
+}
+
+void Scheduler::set_item_(Component *component, const std::string &name, bool named, bool interval, uint32_t delay,
+                          std::function<void()> &&func) {
+  if (named)
+    this->cancel_item_(component, name, interval);
+  if (delay == SCHEDULER_DONT_RUN)
+    return;
+  auto item = std::make_shared<Item>();
+  item->component = component;
+  item->name = name;
+  item->named = named;
+  item->interval = interval;
+  item->period = delay;
+  // The real scheduler starts an interval after a random offset of up to half the interval; here it is always 0
+  item->due_us = testing::now_us() + (interval ? 0 : static_cast<uint64_t>(delay) * 1000);
+  item->order = this->next_order_++;
+  item->func = std::move(func);
+  item->removed = false;
+  this->items_.push_back(std::move(item));
+}
+
+bool Scheduler::cancel_item_(Component *component, const std::string &name, bool interval) {
+  bool found = false;
+  for (auto &item : this->items_) {
+    if (!item->removed && item->named && item->component == component && item->interval == interval &&
+        item->name == name) {
+      item->removed = true;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void Scheduler::call() {
+  const uint64_t now = testing::now_us();
+  std::vector<std::shared_ptr<Item>> due;
+  for (auto &item : this->items_) {
+    if (!item->removed && item->due_us <= now)
+      due.push_back(item);
+  }
+  std::sort(due.begin(), due.end(), [](const std::shared_ptr<Item> &a, const std::shared_ptr<Item> &b) {
+    return a->due_us != b->due_us ? a->due_us < b->due_us : a->order < b->order;
+  });
+  for (auto &item : due) {
+    if (item->removed || testing::is_halted())
+      continue;
+    if (item->interval) {
+      item->due_us = now + std::max<uint64_t>(item->period, 1) * 1000;
+    } else {
+      item->removed = true;
+    }
+    testing::timed_call(item->component, false, [&item]() { item->func(); });
+  }
+  this->items_.erase(std::remove_if(this->items_.begin(), this->items_.end(),
+                                    [](const std::shared_ptr<Item> &item) { return item->removed; }),
+                     this->items_.end());
+}
+
+bool Scheduler::next_due_us(uint64_t *due_us) const {
+  bool found = false;
+  for (const auto &item : this->items_) {
+    if (item->removed || (found && item->due_us >= *due_us))
+      continue;
+    *due_us = item->due_us;
+    found = true;
+  }
+  return found;
+}
+
+size_t Scheduler::size() const {
+  return std::count_if(this->items_.begin(), this->items_.end(),
+                       [](const std::shared_ptr<Item> &item) { return !item->removed; });
+}
+
+// application.h
+
+void Application::setup() {
+  std::stable_sort(this->components_.begin(), this->components_.end(), [](Component *a, Component *b) {
+    return a->get_setup_priority() > b->get_setup_priority();
+  });
+  for (auto *component : this->components_) {
+    component->call_setup();
+    if (testing::is_halted())
+      return;
+  }
+}
+
+void Application::loop() {
+  this->scheduler.call();
+  for (auto *component : this->components_) {
+    if (testing::is_halted())
+      return;
+    testing::timed_call(component, true, [component]() { component->loop(); });
+  }
+}
+
+void Application::run_safe_shutdown_hooks() {
+  for (auto it = this->components_.rbegin(); it != this->components_.rend(); ++it)
+    (*it)->on_safe_shutdown();
+  for (auto it = this->components_.rbegin(); it != this->components_.rend(); ++it)
+    (*it)->on_shutdown();
+}
+
+}  // namespace esphome
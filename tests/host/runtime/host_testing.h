@@ -0,0 +1,68 @@
+#pragma once
+
+// Control surface of the host runtime: the simulated clock, the main loop and the captured log.
+// Components only see the ordinary ESPHome API (millis(), set_timeout(), ESP_LOGx ...).
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+
+class Component;
+
+namespace testing {
+
+/// Clock, scheduler, App, preferences, system time and captured log back to their initial state.
+void reset();
+/// Start a new boot at the current simulated time: millis() and micros() restart from zero and the scheduler and
+/// App are emptied. Preferences and system time are kept, like RTC memory and the RTC.
+void reboot();
+
+/// Simulated time since reset(). Keeps running across reboot().
+uint64_t now_us();
+void advance_us(uint64_t us);
+inline void advance_ms(uint64_t ms) { advance_us(ms * 1000); }
+/// Simulated time spent in delay() and delayMicroseconds() since reset().
+uint64_t blocked_us();
+
+/// System time (what RealTimeClock reports). Unset after reset().
+void set_system_time(int64_t epoch_us);
+bool has_system_time();
+int64_t system_time_us();
+/// Shift the system time, e.g. by the error the RTC slow clock built up during a sleep.
+void adjust_system_time_us(int64_t delta_us);
+
+/// One main loop pass: due scheduler items, then every loop(). Returns false once halted.
+bool loop_once();
+/// Run the main loop every `step_ms` of simulated time for `duration_ms`, or until halted.
+void run_for(uint64_t duration_ms, uint32_t step_ms = 1);
+/// Stop the main loop, e.g. because the device went to sleep. Cleared by reboot().
+void halt();
+bool is_halted();
+
+/// Every call from the main loop into a component: which, whether it was loop() (or a scheduler item), the wall
+/// clock time it took and the simulated time it blocked for.
+struct CallTiming {
+  Component *component;
+  bool is_loop;
+  uint64_t wall_ns;
+  uint64_t blocked_us;
+};
+void set_call_observer(std::function<void(const CallTiming &)> &&observer);
+
+struct LogLine {
+  int level;
+  std::string tag;
+  std::string message;
+};
+/// Lines at or below `level` are printed to stderr. Defaults to ESPHOME_HOST_LOG_LEVEL or errors only.
+void set_print_level(int level);
+/// Every line since reset(), at every level.
+const std::vector<LogLine> &log_lines();
+size_t count_log_lines(int level, const std::string &substring);
+
+}  // namespace testing
+}  // namespace esphome
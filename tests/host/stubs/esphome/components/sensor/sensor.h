@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cmath>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/log.h"
+
+#define LOG_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) { \
+    ESP_LOGCONFIG(TAG, "%s%s '%s'", prefix, type, (obj)->get_name().c_str()); \
+  }
+
+namespace esphome {
+namespace sensor {
+
+// No filters: the raw state is the state.
+class Sensor {
+ public:
+  Sensor() = default;
+  explicit Sensor(std::string name) : name_(std::move(name)) {}
+
+  void set_name(const std::string &name) { this->name_ = name; }
+  const std::string &get_name() const { return this->name_; }
+
+  void publish_state(float state) {
+    this->raw_state = state;
+    this->state = state;
+    this->has_state_ = true;
+    for (auto &callback : this->callbacks_)
+      callback(state);
+  }
+  void add_on_state_callback(std::function<void(float)> &&callback) {
+    this->callbacks_.push_back(std::move(callback));
+  }
+
+  float get_state() const { return this->state; }
+  float get_raw_state() const { return this->raw_state; }
+  bool has_state() const { return this->has_state_; }
+
+  float state{NAN};
+  float raw_state{NAN};
+
+ protected:
+  std::string name_;
+  bool has_state_{false};
+  std::vector<std::function<void(float)>> callbacks_;
+};
+
+}  // namespace sensor
+}  // namespace esphome
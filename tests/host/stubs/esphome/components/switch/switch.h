@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace switch_ {
+
+class Switch {
+ public:
+  virtual ~Switch() = default;
+
+  void turn_on() { this->write_state(true); }
+  void turn_off() { this->write_state(false); }
+  void publish_state(bool state) { this->state = state; }
+
+  void set_name(const std::string &name) { this->name_ = name; }
+  const std::string &get_name() const { return this->name_; }
+
+  bool state{false};
+
+ protected:
+  virtual void write_state(bool state) = 0;
+
+  std::string name_;
+};
+
+}  // namespace switch_
+}  // namespace esphome
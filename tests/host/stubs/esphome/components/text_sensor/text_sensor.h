@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  TextSensor() = default;
+  explicit TextSensor(std::string name) : name_(std::move(name)) {}
+
+  void set_name(const std::string &name) { this->name_ = name; }
+  const std::string &get_name() const { return this->name_; }
+
+  void publish_state(const std::string &state) {
+    this->state = state;
+    this->has_state_ = true;
+    for (auto &callback : this->callbacks_)
+      callback(state);
+  }
+  void add_on_state_callback(std::function<void(std::string)> &&callback) {
+    this->callbacks_.push_back(std::move(callback));
+  }
+
+  std::string get_state() const { return this->state; }
+  bool has_state() const { return this->has_state_; }
+
+  std::string state;
+
+ protected:
+  std::string name_;
+  bool has_state_{false};
+  std::vector<std::function<void(std::string)>> callbacks_;
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
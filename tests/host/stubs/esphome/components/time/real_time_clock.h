@@ -0,0 +1,39 @@
+#pragma once
+
+#include <ctime>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/time.h"
+
+namespace esphome {
+namespace time {
+
+// The system clock is part of the simulation (host_testing.h): it advances with the simulated clock and keeps
+// running through simulated sleeps, like the RTC does.
+class RealTimeClock : public PollingComponent {
+ public:
+  RealTimeClock() : PollingComponent(15 * 60 * 1000) {}
+
+  ESPTime now() { return ESPTime::from_epoch_local(this->timestamp_now()); }
+  ESPTime utcnow() { return ESPTime::from_epoch_utc(this->timestamp_now()); }
+
+  void add_on_time_sync_callback(std::function<void()> &&callback) {
+    this->time_sync_callbacks_.push_back(std::move(callback));
+  }
+
+  void update() override {}
+
+ protected:
+  // 0 until the system time has been set
+  time_t timestamp_now();
+  // Sets the system time and reports the synchronization, like a time source that received the time.
+  void synchronize_epoch_(uint32_t epoch);
+
+  std::vector<std::function<void()>> time_sync_callbacks_;
+};
+
+}  // namespace time
+}  // namespace esphome
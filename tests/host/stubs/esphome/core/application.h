@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/defines.h"
+#include "esphome/core/scheduler.h"
+
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+
+namespace esphome {
+
+class Application {
+ public:
+  template<class C> C *register_component(C *component) {
+    this->components_.push_back(component);
+    return component;
+  }
+#ifdef USE_SENSOR
+  void register_sensor(sensor::Sensor *sensor) { this->sensors_.push_back(sensor); }
+  const std::vector<sensor::Sensor *> &get_sensors() { return this->sensors_; }
+#endif
+
+  // Sorts the components by setup priority and sets them up, like the generated setup() does.
+  void setup();
+  // One main loop pass: the due scheduler items, then every loop().
+  void loop();
+  void run_safe_shutdown_hooks();
+  void feed_wdt() {}
+
+  const std::vector<Component *> &get_components() const { return this->components_; }
+
+  Scheduler scheduler;
+
+ protected:
+  std::vector<Component *> components_;
+#ifdef USE_SENSOR
+  std::vector<sensor::Sensor *> sensors_;
+#endif
+};
+
+extern Application App;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace esphome
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+
+#define TEMPLATABLE_VALUE_(type, name) \
+ protected: \
+  TemplatableValue<type, Ts...> name##_{}; \
+\
+ public: \
+  template<typename V> void set_##name(V name) { this->name##_ = name; }
+
+#define TEMPLATABLE_VALUE(type, name) TEMPLATABLE_VALUE_(type, name)
+
+template<typename T, typename... X> class TemplatableValue {
+ public:
+  TemplatableValue() = default;
+
+  template<typename F, typename std::enable_if<!std::is_invocable<F, X...>::value, int>::type = 0>
+  TemplatableValue(F value) : type_(VALUE), value_(value) {}
+
+  template<typename F, typename std::enable_if<std::is_invocable<F, X...>::value, int>::type = 0>
+  TemplatableValue(F f) : type_(LAMBDA), f_(f) {}
+
+  bool has_value() const { return this->type_ != NONE; }
+
+  T value(X... x) {
+    if (this->type_ == LAMBDA)
+      return this->f_(x...);
+    return this->value_;
+  }
+
+ protected:
+  enum { NONE, VALUE, LAMBDA } type_{NONE};
+  T value_{};
+  std::function<T(X...)> f_;
+};
+
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(Ts... x) {
+    for (auto &callback : this->callbacks_)
+      callback(x...);
+  }
+  // Host harness: stands in for the automation attached in YAML
+  void add_callback(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+
+ protected:
+  std::vector<std::function<void(Ts...)>> callbacks_;
+};
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play(Ts... x) = 0;
+  void play_complex(Ts... x) { this->play(x...); }
+};
+
+}  // namespace esphome
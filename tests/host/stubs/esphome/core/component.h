@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "esphome/core/optional.h"
+
+namespace esphome {
+
+namespace setup_priority {
+
+extern const float BUS;
+extern const float IO;
+extern const float HARDWARE;
+extern const float DATA;
+extern const float PROCESSOR;
+extern const float WIFI;
+extern const float AFTER_WIFI;
+extern const float AFTER_CONNECTION;
+extern const float LATE;
+
+}  // namespace setup_priority
+
+static const uint32_t SCHEDULER_DONT_RUN = 4294967295UL;
+
+#define LOG_UPDATE_INTERVAL(this) \
+  if (this->get_update_interval() == SCHEDULER_DONT_RUN) { \
+    ESP_LOGCONFIG(TAG, "  Update Interval: never"); \
+  } else { \
+    ESP_LOGCONFIG(TAG, "  Update Interval: %.1fs", this->get_update_interval() / 1000.0f); \
+  }
+
+class Component {
+ public:
+  virtual ~Component() = default;
+
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return 0.0f; }
+  virtual float get_loop_priority() const { return 0.0f; }
+  virtual void call_setup() { this->setup(); }
+  virtual void on_shutdown() {}
+  virtual void on_safe_shutdown() {}
+
+  virtual void mark_failed() { this->failed_ = true; }
+  bool is_failed() const { return this->failed_; }
+  void status_set_warning(const char *message = "unspecified") { this->warning_ = true; }
+  void status_clear_warning() { this->warning_ = false; }
+  bool status_has_warning() const { return this->warning_; }
+
+  // Set by the generated code to the name of the component's platform.
+  void set_component_source(const char *source) { this->component_source_ = source; }
+  const char *get_component_source() const {
+    return this->component_source_ == nullptr ? "<unknown>" : this->component_source_;
+  }
+
+ protected:
+  // Same semantics as the real scheduler: a new item replaces the pending one with the same name and type.
+  void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f);
+  void set_interval(uint32_t interval, std::function<void()> &&f);
+  bool cancel_interval(const std::string &name);
+  void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f);
+  void set_timeout(uint32_t timeout, std::function<void()> &&f);
+  bool cancel_timeout(const std::string &name);
+
+  const char *component_source_{nullptr};
+  bool failed_{false};
+  bool warning_{false};
+};
+
+class PollingComponent : public Component {
+ public:
+  PollingComponent() : PollingComponent(0) {}
+  explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+
+  virtual void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+  virtual void update() = 0;
+  void call_setup() override;
+  virtual uint32_t get_update_interval() const { return this->update_interval_; }
+  void start_poller();
+  void stop_poller();
+
+ protected:
+  uint32_t update_interval_;
+};
+
+}  // namespace esphome
@@ -0,0 +1,3 @@
+#pragma once
+
+// Host test build: the USE_* feature defines come from tests/host/CMakeLists.txt instead of codegen.
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esphome/core/gpio.h"
+
+#define IRAM_ATTR
+#define PROGMEM
+
+namespace esphome {
+
+// Backed by the simulated clock in tests/host/runtime; see host_testing.h.
+uint32_t millis();
+uint32_t micros();
+// Advances the simulated clock, so blocking calls show up as loop blocking time.
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+void __attribute__((noreturn)) arch_restart();
+void arch_feed_wdt();
+
+}  // namespace esphome
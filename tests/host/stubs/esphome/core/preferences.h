@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace esphome {
+
+// In-memory preferences; contents survive testing::reboot() like RTC memory does.
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  explicit ESPPreferenceObject(std::vector<uint8_t> *data) : data_(data) {}
+
+  template<typename T> bool save(const T *src) {
+    if (this->data_ == nullptr)
+      return false;
+    const auto *bytes = reinterpret_cast<const uint8_t *>(src);
+    this->data_->assign(bytes, bytes + sizeof(T));
+    return true;
+  }
+
+  template<typename T> bool load(T *dest) {
+    if (this->data_ == nullptr || this->data_->size() != sizeof(T))
+      return false;
+    std::copy(this->data_->begin(), this->data_->end(), reinterpret_cast<uint8_t *>(dest));
+    return true;
+  }
+
+ protected:
+  std::vector<uint8_t> *data_{nullptr};
+};
+
+class ESPPreferences {
+ public:
+  ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+    return ESPPreferenceObject(&this->store_[{type, in_flash}]);
+  }
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+    return this->make_preference(type, in_flash);
+  }
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type) { return this->make_preference(type, true); }
+  void reset() { this->store_.clear(); }
+
+ protected:
+  std::map<std::pair<uint32_t, bool>, std::vector<uint8_t>> store_;
+};
+
+extern ESPPreferences *global_preferences;  // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+}  // namespace esphome
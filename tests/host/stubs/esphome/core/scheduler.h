@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace esphome {
+
+class Component;
+
+// Runs timeouts and intervals against the simulated clock. Items due in the same pass run in order of their due
+// time; items added by a callback run on a later pass.
+class Scheduler {
+ public:
+  void set_timeout(Component *component, const std::string &name, uint32_t timeout, std::function<void()> &&func);
+  bool cancel_timeout(Component *component, const std::string &name);
+  void set_interval(Component *component, const std::string &name, uint32_t interval, std::function<void()> &&func);
+  bool cancel_interval(Component *component, const std::string &name);
+
+  void call();
+  // Simulated time of the next due item, if any
+  bool next_due_us(uint64_t *due_us) const;
+  size_t size() const;
+
+ protected:
+  struct Item {
+    Component *component;
+    std::string name;
+    bool named;
+    bool interval;
+    uint32_t period;
+    uint64_t due_us;
+    uint64_t order;
+    std::function<void()> func;
+    bool removed;
+  };
+
+  void set_item_(Component *component, const std::string &name, bool named, bool interval, uint32_t delay,
+                 std::function<void()> &&func);
+  bool cancel_item_(Component *component, const std::string &name, bool interval);
+
+  std::vector<std::shared_ptr<Item>> items_;
+  uint64_t next_order_{0};
+};
+
+}  // namespace esphome
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+namespace esphome {
+
+struct ESPTime {
+  int8_t second;
+  int8_t minute;
+  int8_t hour;
+  int8_t day_of_week;  // 1 = Sunday
+  int8_t day_of_month;
+  int16_t day_of_year;
+  int8_t month;
+  int16_t year;
+  bool is_dst;
+  time_t timestamp;
+
+  bool is_valid() const { return this->year >= 2019; }
+
+  // The host harness runs in UTC, so local and UTC time are the same.
+  static ESPTime from_epoch_local(time_t epoch) { return from_epoch_utc(epoch); }
+  static ESPTime from_epoch_utc(time_t epoch);
+};
+
+}  // namespace esphome